@@ -0,0 +1,180 @@
+#include "arena.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <gmp.h>
+
+namespace {
+	const size_t blockSize = 1 << 20;
+	const size_t alignment = 16;
+
+	struct Block {
+		char* data;
+		size_t size;
+		size_t used;
+	};
+
+	struct ThreadArena {
+		std::vector<Block> blocks;
+		size_t current = 0; // Index of the block allocations are taken from
+		size_t depth = 0; // Nesting of Arena::Scope
+		bool active = false;
+		char* last = nullptr; // Most recent allocation, which can be grown in place
+		size_t allocated = 0;
+
+		~ThreadArena() {
+			for (const Block& block : blocks) {
+				std::free(block.data);
+			}
+		}
+
+		bool owns(const void* ptr) const {
+			const char* p = static_cast<const char*>(ptr);
+			for (const Block& block : blocks) {
+				if (p >= block.data && p < block.data + block.size) {
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void* allocate(size_t size) {
+			size = (size + alignment - 1) / alignment * alignment;
+			for (; current < blocks.size(); current++) {
+				Block& block = blocks[current];
+				if (block.size - block.used >= size) {
+					last = block.data + block.used;
+					block.used += size;
+					allocated += size;
+					return last;
+				}
+			}
+
+			// No block left with enough room, so add one (large requests get a block of their own)
+			Block block = { static_cast<char*>(std::malloc(size > blockSize ? size : blockSize)), size > blockSize ? size : blockSize, size };
+			if (!block.data) {
+				return nullptr;
+			}
+			blocks.push_back(block);
+			current = blocks.size() - 1;
+			last = block.data;
+			allocated += size;
+			return last;
+		}
+
+		// Grows the most recent allocation without moving it, if its block has room
+		bool extend(void* ptr, size_t oldSize, size_t newSize) {
+			if (ptr != last || current >= blocks.size()) {
+				return false;
+			}
+			Block& block = blocks[current];
+			oldSize = (oldSize + alignment - 1) / alignment * alignment;
+			newSize = (newSize + alignment - 1) / alignment * alignment;
+			if (newSize <= oldSize) {
+				return true;
+			}
+			if (block.size - block.used < newSize - oldSize) {
+				return false;
+			}
+			block.used += newSize - oldSize;
+			allocated += newSize - oldSize;
+			return true;
+		}
+
+		void reset() {
+			for (Block& block : blocks) {
+				block.used = 0;
+			}
+			current = 0;
+			last = nullptr;
+			allocated = 0;
+		}
+	};
+
+	thread_local ThreadArena arena;
+
+	void* (*previousAllocate)(size_t) = nullptr;
+	void* (*previousReallocate)(void*, size_t, size_t) = nullptr;
+	void (*previousFree)(void*, size_t) = nullptr;
+	bool isInstalled = false;
+
+	void* allocateFunction(size_t size) {
+		if (arena.active) {
+			void* ptr = arena.allocate(size);
+			if (ptr) {
+				return ptr;
+			}
+		}
+		return previousAllocate(size);
+	}
+
+	void* reallocateFunction(void* ptr, size_t oldSize, size_t newSize) {
+		// Memory that didn't come from this thread's arena still belongs to the previous allocator, even inside a scope
+		if (!arena.owns(ptr)) {
+			return previousReallocate(ptr, oldSize, newSize);
+		}
+		if (arena.extend(ptr, oldSize, newSize)) {
+			return ptr;
+		}
+
+		void* newPtr = arena.active ? arena.allocate(newSize) : nullptr;
+		if (!newPtr) {
+			newPtr = previousAllocate(newSize);
+		}
+		std::memcpy(newPtr, ptr, oldSize < newSize ? oldSize : newSize);
+		return newPtr;
+	}
+
+	void freeFunction(void* ptr, size_t size) {
+		if (!arena.owns(ptr)) {
+			previousFree(ptr, size);
+		}
+	}
+}
+
+void Arena::install() {
+	if (isInstalled) {
+		return;
+	}
+	mp_get_memory_functions(&previousAllocate, &previousReallocate, &previousFree);
+	mp_set_memory_functions(allocateFunction, reallocateFunction, freeFunction);
+	isInstalled = true;
+}
+
+void Arena::uninstall() {
+	if (!isInstalled) {
+		return;
+	}
+	mp_set_memory_functions(previousAllocate, previousReallocate, previousFree);
+	isInstalled = false;
+}
+
+bool Arena::installed() {
+	return isInstalled;
+}
+
+Arena::Scope::Scope() {
+	arena.depth++;
+	arena.active = true;
+}
+
+Arena::Scope::~Scope() {
+	if (--arena.depth == 0) {
+		arena.active = false;
+		arena.reset();
+	}
+}
+
+Arena::Suspend::Suspend() : active(arena.active) {
+	arena.active = false;
+}
+
+Arena::Suspend::~Suspend() {
+	arena.active = active;
+}
+
+size_t Arena::_allocated() {
+	return arena.allocated;
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstddef>
+
+// Bump allocator for GMP: inside an Arena::Scope, every mpz allocation of the current thread is carved out of thread local blocks, frees are ignored, and everything is released at once when the outermost scope ends.
+// Nothing allocated inside a scope may be used after it ends, so results have to be copied out under an Arena::Suspend first.
+namespace Arena {
+	// Replaces GMP's memory functions for the whole process (mp_set_memory_functions). Call once, before other threads use GMP. Outside of a scope, allocations still go to the previous functions
+	void install();
+
+	// Restores the memory functions that were active before install()
+	void uninstall();
+
+	bool installed();
+
+	class Scope {
+	public:
+		Scope();
+		~Scope();
+		Scope(const Scope&) = delete;
+		Scope& operator=(const Scope&) = delete;
+	};
+
+	// Temporarily sends allocations back to the regular allocator, e.g. to copy results out of a scope
+	class Suspend {
+	public:
+		Suspend();
+		~Suspend();
+		Suspend(const Suspend&) = delete;
+		Suspend& operator=(const Suspend&) = delete;
+
+	private:
+		bool active;
+	};
+
+	size_t _allocated(); // Bytes handed out by the current thread's arena since its last reset
+}
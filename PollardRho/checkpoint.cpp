@@ -0,0 +1,205 @@
+#include "checkpoint.hpp"
+
+#include <cstdio>
+#include <sstream>
+
+#ifdef _WIN32
+#include <io.h>
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <unistd.h>
+#endif
+
+static const std::string header = "PollardRho checkpoint 1";
+
+static void write(std::ostream& file, const mpz_class& value) {
+	file << value.get_str(16) << '\n';
+}
+
+static bool read(std::ifstream& file, mpz_class& value) {
+	std::string str;
+	return (file >> str) && value.set_str(str, 16) == 0;
+}
+
+void Checkpoint::save(const State& state, const std::string& path) {
+	std::ostringstream file;
+
+	file << header << '\n';
+	write(file, state.b);
+	write(file, state.x0);
+	write(file, state.c);
+
+	file << state.factors.size() << '\n';
+	for (const mpz_class& factor : state.factors) {
+		write(file, factor);
+	}
+	file << state.pending.size() << '\n';
+	for (const mpz_class& cofactor : state.pending) {
+		write(file, cofactor);
+	}
+
+	file << state.running << ' ' << state.runs << '\n';
+	write(file, state.rho.x0);
+	write(file, state.rho.c);
+	write(file, state.rho.x);
+	write(file, state.rho.xSave);
+	write(file, state.rho.xProduct);
+	write(file, state.rho.product);
+	file << state.rho.productSize << ' ' << state.rho.powerOfTwo << ' ' << state.rho.iterations << ' ' << state.rho.gcdEvaluations << '\n';
+
+	// Write to a temporary file first and make sure it's on disk, so being interrupted while saving never destroys the previous checkpoint
+	std::string tmpPath = path + ".tmp";
+	std::string data = file.str();
+	FILE* tmpFile = std::fopen(tmpPath.c_str(), "wb");
+	bool written = tmpFile && std::fwrite(data.data(), 1, data.size(), tmpFile) == data.size() && std::fflush(tmpFile) == 0;
+#ifdef _WIN32
+	written = written && _commit(_fileno(tmpFile)) == 0;
+#else
+	written = written && fsync(fileno(tmpFile)) == 0;
+#endif
+	if (tmpFile)
+		written = std::fclose(tmpFile) == 0 && written;
+	if (!written) {
+		std::cout << "Failed to write checkpoint to " << tmpPath << "." << std::endl;
+		return;
+	}
+
+	// Replacing the target in one step, so there is always a complete checkpoint at path
+#ifdef _WIN32
+	bool renamed = MoveFileExA(tmpPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	bool renamed = std::rename(tmpPath.c_str(), path.c_str()) == 0;
+#endif
+	if (!renamed)
+		std::cout << "Failed to replace checkpoint " << path << " with " << tmpPath << "." << std::endl;
+}
+
+bool Checkpoint::load(State& state, const std::string& path) {
+	std::ifstream file(path);
+	std::string line;
+	if (!std::getline(file, line) || line != header) {
+		return false;
+	}
+
+	if (!read(file, state.b) || !read(file, state.x0) || !read(file, state.c)) {
+		return false;
+	}
+
+	size_t size;
+	if (!(file >> size)) {
+		return false;
+	}
+	state.factors.resize(size);
+	for (mpz_class& factor : state.factors) {
+		if (!read(file, factor)) {
+			return false;
+		}
+	}
+	if (!(file >> size)) {
+		return false;
+	}
+	state.pending.resize(size);
+	for (mpz_class& cofactor : state.pending) {
+		if (!read(file, cofactor)) {
+			return false;
+		}
+	}
+
+	if (!(file >> state.running >> state.runs)) {
+		return false;
+	}
+	if (!read(file, state.rho.x0) || !read(file, state.rho.c) || !read(file, state.rho.x) || !read(file, state.rho.xSave) || !read(file, state.rho.xProduct) || !read(file, state.rho.product)) {
+		return false;
+	}
+
+	return static_cast<bool>(file >> state.rho.productSize >> state.rho.powerOfTwo >> state.rho.iterations >> state.rho.gcdEvaluations);
+}
+
+std::vector<mpz_class> Checkpoint::findFactors(mpz_class n, const std::string& path, std::uint64_t snapshotIterations, const mpz_class& b, const mpz_class& s, const mpz_class& x0, const mpz_class& c) {
+	State state = { b, x0, c, {}, {}, false, 0, rhoStart(x0, c) };
+
+	// Like Factorize::findFactors, the sign of n is dropped
+	n = abs(n);
+	if (n == 0 || n == 1)
+		return state.factors;
+
+	// The first two stages are cheap compared to Pollard Rho, so they are simply repeated if interrupted
+	Factorize::_removeSmallFactors(state.factors, n, b);
+
+	if (n != 1) {
+		mpz_class factor = pollardPOne(n, s).value;
+
+		if (factor != n && factor != 1) {
+			state.pending.push_back(factor);
+			n /= factor;
+		}
+		state.pending.push_back(n);
+	}
+
+	save(state, path);
+
+	return _run(state, path, snapshotIterations);
+}
+
+std::vector<mpz_class> Checkpoint::resume(const std::string& path, std::uint64_t snapshotIterations) {
+	State state;
+	if (!load(state, path)) {
+		std::cout << "No valid checkpoint found at " << path << "." << std::endl;
+		return {};
+	}
+
+	return _run(state, path, snapshotIterations);
+}
+
+std::vector<mpz_class> Checkpoint::_run(State& state, const std::string& path, std::uint64_t snapshotIterations) {
+	// Same as Factorize::_getAllFactors, but with the recursion replaced by the pending stack so it can be saved
+	while (!state.pending.empty()) {
+		mpz_class n = state.pending.back();
+
+		if (!state.running) {
+			int isPrime = mpz_probab_prime_p(n.get_mpz_t(), 10);
+			if (isPrime == 2) {
+				state.factors.push_back(n);
+				state.pending.pop_back();
+				continue;
+			}
+
+			// The root is factored as well, in case it is composite (only prime k are tried)
+			mpz_class root;
+			unsigned long k;
+			if (Factorize::_perfectPower(n, state.b, root, k)) {
+				state.pending.pop_back();
+				state.pending.insert(state.pending.end(), k, root);
+				continue;
+			}
+
+			state.running = true;
+			state.runs = 5;
+			state.rho = rhoStart(state.x0, state.c);
+		}
+
+		Result factor = pollardRhoBrentResumable(n, state.rho, snapshotIterations);
+		if (factor.value == n) {
+			// See Factorize::_getAllFactors: give up after a few retries if n is probably prime
+			if (mpz_probab_prime_p(n.get_mpz_t(), 10) == 1 && state.runs-- == 0) {
+				state.factors.push_back(n);
+				state.pending.pop_back();
+				state.running = false;
+			}
+			else {
+				state.rho = rhoStart(state.rho.x0, Factorize::_nextC(n, state.rho.x0, state.rho.c));
+			}
+		}
+		else if (factor.value != 1) {
+			state.pending.pop_back();
+			state.pending.push_back(factor.value);
+			state.pending.push_back(n / factor.value);
+			state.running = false;
+		}
+
+		save(state, path);
+	}
+
+	return state.factors;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include "factorize.hpp"
+
+#include <fstream>
+#include <string>
+
+namespace Checkpoint {
+	// Everything needed to continue a factorization: the options it was started with, the factors found so far, the cofactors still to be factored and the walk currently running on pending.back()
+	struct State {
+		mpz_class b;
+		mpz_class x0;
+		mpz_class c;
+		std::vector<mpz_class> factors;
+		std::vector<mpz_class> pending;
+		bool running;
+		std::uint64_t runs; // Remaining retries with a new c if pending.back() is probably prime
+		RhoState rho;
+	};
+
+	void save(const State& state, const std::string& path);
+
+	bool load(State& state, const std::string& path);
+
+	/** This function factors n like Factorize::findFactors, but saves its progress to a file every snapshotIterations iterations of Pollard Rho (Brent), so it can be resumed after being interrupted.
+	 * @param n The number to factor
+	 * @param path The file to save the checkpoints to
+	 * @param snapshotIterations The number of iterations between two checkpoints
+	 * @param b The bound for small factors to search for
+	 * @param s The bound for which to find the product of all prime factors with an s-powersmooth predecessor
+	 * @param x0 The initial value for Pollard Rho factoring
+	 * @param c The constant for Pollard Rho factoring
+	 *
+	 * @result All prime factors of n
+	 */
+	std::vector<mpz_class> findFactors(mpz_class n, const std::string& path, std::uint64_t snapshotIterations = 10000000, const mpz_class& b = 1699, const mpz_class& s = 2000, const mpz_class& x0 = 2, const mpz_class& c = 1);
+
+	/** This function continues a factorization from the checkpoint saved at path.
+	 * @param path The file the checkpoints were saved to
+	 * @param snapshotIterations The number of iterations between two checkpoints
+	 *
+	 * @result All prime factors of the number that was originally passed, or an empty vector if there is no valid checkpoint at path
+	 */
+	std::vector<mpz_class> resume(const std::string& path, std::uint64_t snapshotIterations = 10000000);
+
+	std::vector<mpz_class> _run(State& state, const std::string& path, std::uint64_t snapshotIterations);
+}
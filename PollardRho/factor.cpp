@@ -0,0 +1,57 @@
+#include "factorize.hpp"
+
+#include <string>
+
+// Minimal command line front end without the analysis code: factors every argument, or every line of stdin if there are none, and prints "n: factors"
+// With --smooth B first, only prime factors up to B are searched for, and the line ends with the unfactored cofactor as "[cofactor]" (followed by "?" if it may still have factors up to B)
+static void printFactors(const std::string& str, FactorResult& result, const SmoothOptions* smooth) {
+	mpz_class n;
+	if (n.set_str(str, 10) != 0) {
+		std::cout << str << ": not a number" << std::endl;
+		return;
+	}
+
+	bool complete = true;
+	if (smooth)
+		complete = Factorize::findSmoothFactors(n, result, *smooth);
+	else
+		Factorize::findFactors(n, result);
+	std::cout << str << ":";
+	for (const mpz_class& factor : result) {
+		std::cout << " " << factor.get_str();
+	}
+	if (smooth && result.cofactor != 1) {
+		std::cout << " [" << result.cofactor.get_str() << "]" << (complete ? "" : "?");
+	}
+	std::cout << std::endl;
+}
+
+int main(int argc, char* argv[]) {
+	FactorResult result; // Reused for every number
+	SmoothOptions smoothOptions;
+	const SmoothOptions* smooth = nullptr;
+	int first = 1;
+	if (argc > 2 && std::string(argv[1]) == "--smooth") {
+		if (smoothOptions.bound.set_str(argv[2], 10) != 0) {
+			std::cout << argv[2] << ": not a number" << std::endl;
+			return 1;
+		}
+		smooth = &smoothOptions;
+		first = 3;
+	}
+
+	if (argc > first) {
+		for (int i = first; i < argc; i++) {
+			printFactors(argv[i], result, smooth);
+		}
+		return 0;
+	}
+
+	for (std::string line; std::getline(std::cin, line);) {
+		if (!line.empty()) {
+			printFactors(line, result, smooth);
+		}
+	}
+
+	return 0;
+}
@@ -1,48 +1,53 @@
 #include "factorize.hpp"
+#include "sieve.hpp"
+#include "arena.hpp"
+#include "trace.hpp"
 
-Result pollardRhoFloyd(const mpz_class& n, const mpz_class& x0, const mpz_class& c) {
-	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+// Number of differences multiplied together before taking a gcd, n^(1/16). Only needs clamping for n beyond 2^512 (unsigned long may be 32 bits)
+static std::uint64_t productBound(const mpz_class& n) {
+	mpz_class q;
+	mpz_root(q.get_mpz_t(), n.get_mpz_t(), 16);
+	return q.fits_ulong_p() ? q.get_ui() : std::numeric_limits<unsigned long>::max();
+}
+
+Result pollardRhoFloyd(const mpz_class& n, const mpz_class& x0, const mpz_class& c, const IterationMap& map) {
+	Trace::Span span("pollardRhoFloyd");
 
 	mpz_class x1 = x0;
 	mpz_class x2 = x0;
 	mpz_class diff;
 	mpz_class d = 1;
-	mpz_class gcdEvaluations = 0;
-	mpz_class iteration = 0;
+	std::uint64_t gcdEvaluations = 0;
+	std::uint64_t iteration = 0;
 	for (; d == 1; gcdEvaluations++, iteration += 3) {
-		x1 = f(x1, c) % n;
-		x2 = f(f(x2, c), c) % n;
+		map.apply(x1, c, n);
+		map.apply(x2, c, n);
+		map.apply(x2, c, n);
 		diff = x1 - x2;
 		mpz_gcd(d.get_mpz_t(), diff.get_mpz_t(), n.get_mpz_t());
 	}
 
-	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
-	auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
-
-	return { d, gcdEvaluations, iteration, elapsed };
+	return { d, gcdEvaluations, iteration, span.elapsed() };
 }
 
-Result pollardRhoFloydImproved(const mpz_class& n, const mpz_class& x0, const mpz_class& c) {
-	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+Result pollardRhoFloydImproved(const mpz_class& n, const mpz_class& x0, const mpz_class& c, const IterationMap& map) {
+	Trace::Span span("pollardRhoFloydImproved");
 
 	mpz_class x1Save, x2Save;
-	mpz_class q;
-	mpz_sqrt(q.get_mpz_t(), n.get_mpz_t());
-	mpz_sqrt(q.get_mpz_t(), q.get_mpz_t());
-	mpz_sqrt(q.get_mpz_t(), q.get_mpz_t());
-	mpz_sqrt(q.get_mpz_t(), q.get_mpz_t());
+	std::uint64_t q = productBound(n);
 
 	mpz_class x1 = x0;
 	mpz_class x2 = x0;
 	mpz_class diff;
 	mpz_class d = 1;
-	mpz_class gcdEvaluations = 0;
-	mpz_class iteration = 0;
+	std::uint64_t gcdEvaluations = 0;
+	std::uint64_t iteration = 0;
 	for (; d == 1; gcdEvaluations++) {
 		diff = 1;
-		for (size_t i = 0; i < q; i++, iteration += 3) {
-			x1 = f(x1, c) % n;
-			x2 = f(f(x2, c), c) % n;
+		for (std::uint64_t i = 0; i < q; i++, iteration += 3) {
+			map.apply(x1, c, n);
+			map.apply(x2, c, n);
+			map.apply(x2, c, n);
 			diff *= (x1 - x2);
 			if (i == 0) {
 				x1Save = x1;
@@ -57,81 +62,76 @@ Result pollardRhoFloydImproved(const mpz_class& n, const mpz_class& x0, const mp
 		x2 = x2Save;
 		d = 1;
 		for (; d == 1; gcdEvaluations++, iteration += 3) {
-			x1 = f(x1, c) % n;
-			x2 = f(f(x2, c), c) % n;
+			map.apply(x1, c, n);
+			map.apply(x2, c, n);
+			map.apply(x2, c, n);
 			diff = x1 - x2;
 			mpz_gcd(d.get_mpz_t(), diff.get_mpz_t(), n.get_mpz_t());
 		}
 	}
 
-	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
-	auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
-
-	return { d, gcdEvaluations, iteration, elapsed };
+	return { d, gcdEvaluations, iteration, span.elapsed() };
 }
 
-Result pollardRhoBrent(const mpz_class& n, const mpz_class& x0, const mpz_class& c) {
-	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+Result pollardRhoBrent(const mpz_class& n, const mpz_class& x0, const mpz_class& c, const IterationMap& map) {
+	Trace::Span span("pollardRhoBrent");
 
-	mpz_class powerOfTwo = 1;
+	std::uint64_t powerOfTwo = 1;
 	mpz_class xSave;
 
-	mpz_class x1 = f(x0, c) % n;
-	mpz_class x2 = f(x1, c) % n;
+	mpz_class x1 = x0;
+	map.apply(x1, c, n);
+	mpz_class x2 = x1;
+	map.apply(x2, c, n);
 	mpz_class diff = x1 - x2;
 	mpz_class d;
 	mpz_gcd(d.get_mpz_t(), diff.get_mpz_t(), n.get_mpz_t());
 
-	mpz_class gcdEvaluations = 1;
-	mpz_class iteration = 2;
+	std::uint64_t gcdEvaluations = 1;
+	std::uint64_t iteration = 2;
 	for (mpz_class x = x2; d == 1; powerOfTwo *= 2) {
 		xSave = x;
 
 		for (; iteration < 3 * powerOfTwo; iteration++) {
-			x = f(x, c) % n;
+			map.apply(x, c, n);
 		}
 
 		for (; d == 1 && iteration < powerOfTwo * 4; iteration++, gcdEvaluations++) {
-			x = f(x, c) % n;
+			map.apply(x, c, n);
 			diff = xSave - x;
 			mpz_gcd(d.get_mpz_t(), diff.get_mpz_t(), n.get_mpz_t());
 		}
 	}
 
-	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
-	auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
-
-	return { d, gcdEvaluations, iteration, elapsed };
+	return { d, gcdEvaluations, iteration, span.elapsed() };
 }
 
-Result pollardRhoBrentImproved(const mpz_class& n, const mpz_class& x0, const mpz_class& c) {
-	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+Result pollardRhoBrentImproved(const mpz_class& n, const mpz_class& x0, const mpz_class& c, const IterationMap& map) {
+	Trace::Span span("pollardRhoBrentImproved");
 
-	std::pair<std::pair<mpz_class, mpz_class>, std::pair<mpz_class, mpz_class>> save;
-	mpz_class q;
-	mpz_sqrt(q.get_mpz_t(), n.get_mpz_t());
-	mpz_sqrt(q.get_mpz_t(), q.get_mpz_t());
-	mpz_sqrt(q.get_mpz_t(), q.get_mpz_t());
-	mpz_sqrt(q.get_mpz_t(), q.get_mpz_t());
+	std::pair<std::pair<std::uint64_t, mpz_class>, std::pair<std::uint64_t, mpz_class>> save;
+	std::uint64_t q = productBound(n);
 
-	mpz_class powerOfTwo = 1;
+	std::uint64_t powerOfTwo = 1;
 	mpz_class xSave;
 
-	mpz_class x1 = f(x0, c) % n;
-	mpz_class x2 = f(x1, c) % n;
+	mpz_class x1 = x0;
+	map.apply(x1, c, n);
+	mpz_class x2 = x1;
+	map.apply(x2, c, n);
 	mpz_class diff = x1 - x2;
 	mpz_class d;
 	mpz_gcd(d.get_mpz_t(), diff.get_mpz_t(), n.get_mpz_t());
 
-	mpz_class i = 0;
+	std::uint64_t i = 0;
 
-	mpz_class gcdEvaluations = 1;
-	mpz_class iteration = 2;
+	std::uint64_t gcdEvaluations = 1;
+	std::uint64_t iteration = 2;
 	for (mpz_class x = x2; d == 1; powerOfTwo *= 2) {
 		xSave = x;
 
 		for (; iteration < 3 * powerOfTwo; iteration++) {
-			x = f(x, c) % n;
+			map.apply(x, c, n);
 		}
 
 		diff = 1;
@@ -141,40 +141,93 @@ Result pollardRhoBrentImproved(const mpz_class& n, const mpz_class& x0, const mp
 				gcdEvaluations++;
 
 				save = std::make_pair(std::make_pair(powerOfTwo, xSave), std::make_pair(iteration, x));
+				diff = 1;
 				i = 0;
 			}
 
-			x = f(x, c) % n;
+			map.apply(x, c, n);
 			diff *= xSave - x;
 		}
 	}
 
-	mpz_class iterations = iteration;
+	std::uint64_t iterations = iteration;
 	if (d == n) {
 		powerOfTwo = save.first.first;
 		xSave = save.first.second;
 		iteration = save.second.first;
 		for (mpz_class x = save.second.second; d == 1; powerOfTwo *= 2) {
 			for (; iteration < 3 * powerOfTwo; iteration++, iterations++) {
-				x = f(x, c) % n;
+				map.apply(x, c, n);
 			}
 
 			for (; d == 1 && iteration < powerOfTwo * 4; iteration++, iterations++, gcdEvaluations++) {
-				x = f(x, c) % n;
+				map.apply(x, c, n);
 				diff = xSave - x;
 				mpz_gcd(d.get_mpz_t(), diff.get_mpz_t(), n.get_mpz_t());
 			}
 		}
 	}
 
-	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
-	auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
+	return { d, gcdEvaluations, iteration, span.elapsed() };
+}
+
+RhoState rhoStart(const mpz_class& x0, const mpz_class& c) {
+	return { x0, c, x0, x0, x0, 1, 0, 1, 0, 0 };
+}
+
+// Brent's algorithm with accumulated products, running at most maxIterations steps. Returns 1 if the budget ran out before a factor (or n) was found, in which case state can be continued
+Result pollardRhoBrentResumable(const mpz_class& n, RhoState& state, std::uint64_t maxIterations) {
+	Trace::Span span("pollardRhoBrentResumable");
+
+	std::uint64_t q = productBound(n);
 
-	return { d, gcdEvaluations, iteration, elapsed };
+	mpz_class diff;
+	mpz_class d = 1;
+	for (std::uint64_t i = 0; d == 1 && i < maxIterations; i++) {
+		state.x = f(state.x, state.c) % n;
+		state.iterations++;
+
+		if (state.iterations > state.powerOfTwo) {
+			diff = state.xSave - state.x;
+			state.product = (state.product * diff) % n;
+			state.productSize++;
+		}
+
+		// Never let a product span two powers of two, so xSave stays valid when backtracking
+		if (state.productSize && (state.productSize >= q || state.iterations == 2 * state.powerOfTwo)) {
+			mpz_gcd(d.get_mpz_t(), state.product.get_mpz_t(), n.get_mpz_t());
+			state.gcdEvaluations++;
+
+			if (d == n) {
+				d = 1;
+				for (state.x = state.xProduct; d == 1; state.iterations++, state.gcdEvaluations++) {
+					state.x = f(state.x, state.c) % n;
+					diff = state.xSave - state.x;
+					mpz_gcd(d.get_mpz_t(), diff.get_mpz_t(), n.get_mpz_t());
+				}
+			}
+
+			state.product = 1;
+			state.productSize = 0;
+			state.xProduct = state.x;
+		}
+
+		if (state.iterations == 2 * state.powerOfTwo) {
+			state.powerOfTwo *= 2;
+		}
+		if (state.iterations == state.powerOfTwo) {
+			state.xSave = state.x;
+		}
+	}
+
+	return { d, state.gcdEvaluations, state.iterations, span.elapsed() };
 }
 
+// Bounds up to this keep their prime powers in a thread local table (82025 entries at the limit), larger ones are sieved again on every call
+static const std::uint64_t pOneTableBound = 1 << 20;
+
 Result pollardPOne(const mpz_class& n, const mpz_class& s) {
-	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	Trace::Span span("pollardPOne");
 
 	mpz_class g;
 	if (mpz_odd_p(n.get_mpz_t())) {
@@ -185,46 +238,84 @@ Result pollardPOne(const mpz_class& n, const mpz_class& s) {
 	}
 
 	mpz_class r = g;
-	mpz_class iteration = 0;
-	for (mpz_class i = 2; i <= s; mpz_nextprime(i.get_mpz_t(), i.get_mpz_t()), iteration++) {
-		mpfr::mpreal alpha = floor(log(mpfr::mpreal(s.get_str())) / log(mpfr::mpreal(i.get_str())));
-		mpz_class q;
-		mpz_pow_ui(q.get_mpz_t(), i.get_mpz_t(), alpha.toULong());
-
-		mpz_powm(r.get_mpz_t(), r.get_mpz_t(), q.get_mpz_t(), n.get_mpz_t());
+	std::uint64_t iteration = 0;
+	auto raise = [&r, &n, &iteration](std::uint64_t q) {
+		if (q <= std::numeric_limits<unsigned long>::max()) {
+			mpz_powm_ui(r.get_mpz_t(), r.get_mpz_t(), static_cast<unsigned long>(q), n.get_mpz_t());
+		}
+		else {
+			mpz_powm(r.get_mpz_t(), r.get_mpz_t(), fromUInt64(q).get_mpz_t(), n.get_mpz_t());
+		}
+		iteration++;
+	};
+
+	std::uint64_t bound = toUInt64(s);
+	if (bound <= pOneTableBound) {
+		// The table only depends on s, which rarely changes between calls
+		static thread_local std::uint64_t tableBound = 0;
+		static thread_local std::vector<std::uint64_t> powers;
+		if (tableBound != bound) {
+			tableBound = bound;
+			powers = primePowers(bound);
+		}
+		for (const std::uint64_t& q : powers) {
+			raise(q);
+		}
+	}
+	else {
+		// A table for a large s would cost hundreds of megabytes per thread, so the prime powers come straight from the sieve
+		PrimeSieve primes(bound);
+		for (std::uint64_t p = primes.next(); p; p = primes.next()) {
+			std::uint64_t q = p;
+			for (; q <= bound / p; q *= p);
+			raise(q);
+		}
 	}
 
 	r -= 1;
 	mpz_class d;
 	mpz_gcd(d.get_mpz_t(), r.get_mpz_t(), n.get_mpz_t());
 
-	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
-	auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
+	return { d, 1, iteration, span.elapsed() };
+}
+
+// Adds factor with the given multiplicity: Factorization keeps it as a single prime power, flat containers get every copy
+template <typename Factors>
+static void pushFactor(Factors& factors, const mpz_class& factor, unsigned long multiplicity) {
+	for (unsigned long i = 0; i < multiplicity; i++) {
+		factors.push_back(factor);
+	}
+}
 
-	return { d, 1, iteration, elapsed };
+static void pushFactor(Factorization& factors, const mpz_class& factor, unsigned long multiplicity) {
+	factors.push_back(factor, multiplicity);
 }
 
-void Factorize::_removeSmallFactors(std::vector<mpz_class>& factors, mpz_class& n, const mpz_class& b) {
+template <typename Factors>
+void Factorize::_removeSmallFactors(Factors& factors, mpz_class& n, const mpz_class& b) {
+	Trace::Span span("removeSmallFactors");
 	mpz_class p = primorial(b); // Alternatively, can access OEIS bFile containing primorials up to 2000
 	mpz_class g;
 
 	std::vector<int> basicDivisors = { 2, 3, 5 };
 	std::vector<int> divisors = { 1, 7, 11, 13, 17, 19, 23, 29 };
+	// g holds each small prime of n once, mpz_remove() then takes out all of its powers at once
+	mpz_class divisor;
 	for (mpz_gcd(g.get_mpz_t(), p.get_mpz_t(), n.get_mpz_t()); g > 1; mpz_gcd(g.get_mpz_t(), p.get_mpz_t(), n.get_mpz_t())) {
-		n /= g;
-
-		for (const int& divisor : basicDivisors) {
-			if (g % divisor == 0) {
-				factors.push_back(divisor);
+		for (const int& basicDivisor : basicDivisors) {
+			if (g % basicDivisor == 0) {
+				divisor = basicDivisor;
+				pushFactor(factors, divisor, static_cast<unsigned long>(mpz_remove(n.get_mpz_t(), n.get_mpz_t(), divisor.get_mpz_t())));
 				g /= divisor;
 			}
 		}
 
-		for (mpz_class expression = 7, k = 0; expression < b; k++) {
-			for (size_t i = k == 0 ? 1 : 0; i < 8 && expression < b; i++) {
+		// <= so the last candidate tried is at least b, otherwise a prime b itself (like b = 7) stays in g forever
+		for (mpz_class expression = 7, k = 0; expression <= b && g > 1; k++) {
+			for (size_t i = k == 0 ? 1 : 0; i < 8 && expression <= b; i++) {
 				expression = 30 * k + divisors[i];
 				if (g % expression == 0) {
-					factors.push_back(expression);
+					pushFactor(factors, expression, static_cast<unsigned long>(mpz_remove(n.get_mpz_t(), n.get_mpz_t(), expression.get_mpz_t())));
 					g /= expression;
 				}
 			}
@@ -232,30 +323,102 @@ void Factorize::_removeSmallFactors(std::vector<mpz_class>& factors, mpz_class&
 	}
 }
 
-void Factorize::_getAllFactors(std::vector<mpz_class>& factors, mpz_class n, const mpz_class& b, const mpz_class& x0, const mpz_class& c, PollardRho pRho) {
+mpz_class Factorize::_nextC(const mpz_class& n, const mpz_class& x0, const mpz_class& c, const IterationMap& map) {
+	// The c we want to avoid depend on the map: for x^2 + c they are 0 or -2 mod N, and staying at x0 (c = - x0 * (x0 +- 1) mod N)
+	mpz_class cInc;
+	for (cInc = (c + 1) % n; map.stalls(x0, cInc, n); cInc = (cInc + 1) % n);
+	return cInc;
+}
+
+RetryStream::RetryStream(const mpz_class& n, std::uint64_t seed) : n(n) {
+	// Mixing in the low 64 bits of n gives every cofactor its own stream, whatever order they are factored in
+	mpz_class low = n % (mpz_class(1) << 64);
+	std::seed_seq sequence = { static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32), static_cast<std::uint32_t>(toUInt64(low)), static_cast<std::uint32_t>(toUInt64(low) >> 32) };
+	generator.seed(sequence);
+}
+
+void RetryStream::exclude(const mpz_class& c) {
+	excluded.push_back(c % n);
+}
+
+void RetryStream::next(mpz_class& x0, mpz_class& c, const IterationMap& map) {
+	// Below 2^64, a 64 bit draw reduced mod n is close enough to uniform; beyond it, the walk doesn't care
+	do {
+		x0 = fromUInt64(generator()) % n;
+		c = fromUInt64(generator()) % n;
+	} while (map.stalls(x0, c, n) || std::find(excluded.begin(), excluded.end(), c) != excluded.end());
+}
+
+bool Factorize::_perfectPower(const mpz_class& n, const mpz_class& b, mpz_class& root, unsigned long& k) {
+	Trace::Span span("perfectPower");
+	// The root is at least b, so k <= log(n) / log(b), bounded from above using bit lengths
+	size_t bBits = b > 1 ? mpz_sizeinbase(b.get_mpz_t(), 2) - 1 : 1;
+	unsigned long maxK = static_cast<unsigned long>(mpz_sizeinbase(n.get_mpz_t(), 2) / bBits);
+	PrimeSieve primes(maxK);
+	for (std::uint64_t p = primes.next(); p; p = primes.next()) {
+		mpz_class remainder;
+		mpz_rootrem(root.get_mpz_t(), remainder.get_mpz_t(), n.get_mpz_t(), static_cast<unsigned long>(p));
+		if (remainder == 0) {
+			k = static_cast<unsigned long>(p);
+			return true;
+		}
+	}
+	return false;
+}
+
+void Factorize::_retry(const mpz_class& n, mpz_class& x0, mpz_class& c, const IterationMap& map, Retry retry, std::uint64_t seed, std::optional<RetryStream>& stream) {
+	if (retry == Retry::Random) {
+		if (!stream)
+			stream.emplace(n, seed);
+		stream->exclude(c);
+		stream->next(x0, c, map);
+	}
+	else {
+		// We want to increment c because incrementing x0 is less likely to avoid consecutive failures
+		c = _nextC(n, x0, c, map);
+	}
+}
+
+template <typename Factors>
+void Factorize::_getAllFactors(Factors& factors, mpz_class n, const mpz_class& b, const mpz_class& x0, const mpz_class& c, PollardRho pRho, const IterationMap& map, Retry retry, std::uint64_t seed) {
+	// Nested calls show up as deeper spans of the same name in the trace
+	Trace::Span span("getAllFactors");
+
 	// Check if n is prime
-	int isPrime = mpz_probab_prime_p(n.get_mpz_t(), 10); // 2 denotes guaranteed prime, 1 denotes probably prime, 0 denotes guaranteed composite
+	int isPrime;
+	{
+		Trace::Span primeSpan("isPrime");
+		isPrime = mpz_probab_prime_p(n.get_mpz_t(), 10); // 2 denotes guaranteed prime, 1 denotes probably prime, 0 denotes guaranteed composite
+	}
 	if (isPrime == 2) {
 		factors.push_back(n);
 		return;
 	}
 	else {
 		// Check if n is a perfect power (alternatively, mpz_perfect_power_p(), but we want to use the fact that there are no factors below b left in N to our advantage)
-		mpfr::mpreal max_k = b > 1 ? floor(log(mpfr::mpreal(n.get_str())) / log(mpfr::mpreal(b.get_str()))) : floor(log(mpfr::mpreal(n.get_str())) / log(mpfr::mpreal(2)));
-		for (mpz_class k = 2; k <= max_k.toULong(); mpz_nextprime(k.get_mpz_t(), k.get_mpz_t())) {
-			mpz_class result, remainder;
-			mpz_rootrem(result.get_mpz_t(), remainder.get_mpz_t(), n.get_mpz_t(), k.get_ui());
-			if (remainder == 0) {
-				std::vector<mpz_class> perfectPowerFactors(k.get_ui(), result);
-				factors.insert(factors.end(), perfectPowerFactors.begin(), perfectPowerFactors.end());
-				return;
+		mpz_class root;
+		unsigned long k;
+		if (_perfectPower(n, b, root, k)) {
+			// Only prime k are tried, so p^4 shows up as (p^2)^2 and the root has to be factored as well
+			if (mpz_probab_prime_p(root.get_mpz_t(), 10)) {
+				pushFactor(factors, root, k);
+			}
+			else {
+				Factorization powers;
+				Factorize::_getAllFactors(powers, root, b, x0, c, pRho, map, retry, seed);
+				for (const std::pair<mpz_class, unsigned long>& power : powers) {
+					pushFactor(factors, power.first, power.second * k);
+				}
 			}
+			return;
 		}
 
 		// Apply factoring algorithm
 		Result factor;
+		mpz_class x0Inc(x0);
 		mpz_class cInc(c);
-		std::function<Result(const mpz_class&, const mpz_class&, const mpz_class&)> rhoFunction;
+		std::optional<RetryStream> stream; // Only set up once a walk fails
+		std::function<Result(const mpz_class&, const mpz_class&, const mpz_class&, const IterationMap&)> rhoFunction;
 		switch (pRho) {
 		case PollardRho::Floyd:
 			rhoFunction = pollardRhoFloyd;
@@ -267,14 +430,15 @@ void Factorize::_getAllFactors(std::vector<mpz_class>& factors, mpz_class n, con
 			rhoFunction = pollardRhoBrent;
 			break;
 		}
+		// A start that is stuck under this map (like x0 = 2, c = 1 under x^(2k) + c when 2^(2k) = 1 mod n) would only waste a walk, and one of the runs below
+		if (map.stalls(x0Inc, cInc, n))
+			_retry(n, x0Inc, cInc, map, retry, seed, stream);
 		// This is the most dangerous spot to be in: we aren't sure if N is prime, so we are forced to try Pollard Rho (multiple times unless we find a factor, since the algorithm can fail for some (consecutive) c)
 		// We thereby must run the algorithm arbitrarily many times and, upon failing every time, assume that N is prime. One must note that the runtime for failure for prime N is O(sqrt(N)) rather than O(sqrt(p)) (failure due to c is still O(sqrt(p))
 		if (isPrime == 1) {
 			size_t runs = 5;
-			for (factor = rhoFunction(n, x0, cInc); runs && factor.value == n; factor = rhoFunction(n, x0, cInc), runs--) {
-				// 3 cases of c we want to avoid: 0 or -2 mod N, and staying at x0. (last occurs when c = - x0 * (x0 +- 1) mod N)
-				// We want to increment c because incrementing x0 is less likely to avoid consecutive failures
-				for (cInc = (cInc + 1) % n; cInc % n == 0 || (cInc + 2) % n == 0 || (cInc + x0 * (x0 + 1)) % n == 0 || (cInc + x0 * (x0 - 1)) % n == 0; cInc = (cInc + 1) % n);
+			for (factor = rhoFunction(n, x0Inc, cInc, map); runs && factor.value == n; factor = rhoFunction(n, x0Inc, cInc, map), runs--) {
+				_retry(n, x0Inc, cInc, map, retry, seed, stream);
 			}
 			if (factor.value == n) {
 				factors.push_back(factor.value);
@@ -283,13 +447,216 @@ void Factorize::_getAllFactors(std::vector<mpz_class>& factors, mpz_class n, con
 		}
 		// Here we know N is composite, so we apply Pollard Rho until we find a factor
 		else {
-			for (factor = rhoFunction(n, x0, cInc); factor.value == n; factor = rhoFunction(n, x0, cInc)) {
-				// 3 cases of c we want to avoid: 0 or -2 mod N, and staying at x0. (last occurs when c = - x0 * (x0 +- 1) mod N),
-				// We want to increment c because incrementing x0 is less likely to avoid consecutive failures
-				for (cInc = (cInc + 1) % n; cInc % n == 0 || (cInc + 2) % n == 0 || (cInc + x0 * (x0 + 1)) % n == 0 || (cInc + x0 * (x0 - 1)) % n == 0; cInc = (cInc + 1) % n);
+			for (factor = rhoFunction(n, x0Inc, cInc, map); factor.value == n; factor = rhoFunction(n, x0Inc, cInc, map)) {
+				_retry(n, x0Inc, cInc, map, retry, seed, stream);
 			}
 		}
-		Factorize::_getAllFactors(factors, factor.value, b, x0, c, pRho);
-		Factorize::_getAllFactors(factors, n / factor.value, b, x0, c, pRho);
+		Factorize::_getAllFactors(factors, factor.value, b, x0, c, pRho, map, retry, seed);
+		Factorize::_getAllFactors(factors, n / factor.value, b, x0, c, pRho, map, retry, seed);
+	}
+}
+
+template void Factorize::_removeSmallFactors<std::vector<mpz_class>>(std::vector<mpz_class>& factors, mpz_class& n, const mpz_class& b);
+template void Factorize::_removeSmallFactors<FactorResult>(FactorResult& factors, mpz_class& n, const mpz_class& b);
+template void Factorize::_removeSmallFactors<Factorization>(Factorization& factors, mpz_class& n, const mpz_class& b);
+template void Factorize::_getAllFactors<std::vector<mpz_class>>(std::vector<mpz_class>& factors, mpz_class n, const mpz_class& b, const mpz_class& x0, const mpz_class& c, PollardRho pRho, const IterationMap& map, Retry retry, std::uint64_t seed);
+template void Factorize::_getAllFactors<FactorResult>(FactorResult& factors, mpz_class n, const mpz_class& b, const mpz_class& x0, const mpz_class& c, PollardRho pRho, const IterationMap& map, Retry retry, std::uint64_t seed);
+template void Factorize::_getAllFactors<Factorization>(Factorization& factors, mpz_class n, const mpz_class& b, const mpz_class& x0, const mpz_class& c, PollardRho pRho, const IterationMap& map, Retry retry, std::uint64_t seed);
+
+void Factorize::findFactors(const mpz_class& n, FactorResult& result, const FactorOptions& options) {
+	_findFactors(n, result, options);
+}
+
+void Factorize::findFactors(const mpz_class& n, Factorization& result, const FactorOptions& options) {
+	_findFactors(n, result, options);
+}
+
+bool Factorize::findSmoothFactors(const mpz_class& n, FactorResult& result, const SmoothOptions& options) {
+	Trace::Span span("findSmoothFactors");
+	result.clear();
+	mpz_class& cofactor = result.cofactor;
+	cofactor = n;
+	if (n == 0 || n == 1 || n == -1)
+		return true;
+
+	// Factor |n| and give the sign to the cofactor
+	if (n < 0) {
+		mpz_class m = -n;
+		bool complete = findSmoothFactors(m, result, options);
+		result.cofactor = -result.cofactor;
+		return complete;
+	}
+
+	// Trial division, which is all there is to do if it already covers the bound
+	mpz_class b = options.b < options.bound ? options.b : options.bound;
+	_removeSmallFactors(result, cofactor, b);
+	if (cofactor == 1 || options.bound <= b)
+		return true;
+
+	std::vector<mpz_class> parts = { cofactor };
+	cofactor = 1;
+
+	// Pollard p - 1 on everything that is left
+	mpz_class s = options.s < options.bound ? options.s : options.bound;
+	mpz_class factor = pollardPOne(parts.back(), s).value;
+	if (factor != parts.back() && factor != 1) {
+		parts.back() /= factor;
+		parts.push_back(factor);
+	}
+
+	// Brent needs about 1.25 sqrt(p) iterations for a factor p, so a part that survives a few times sqrt(B) most likely has no factor up to B
+	std::uint64_t partBudget = 4 * toUInt64(sqrt(options.bound)) + 4;
+	std::uint64_t budget = options.budget;
+	mpz_class b2 = b * b;
+	mpz_class root;
+	bool complete = true;
+	while (!parts.empty()) {
+		mpz_class part = parts.back();
+		parts.pop_back();
+
+		// No factors below b are left, so anything below b^2 is prime
+		if (part == 1)
+			continue;
+		if (part < b2 || mpz_probab_prime_p(part.get_mpz_t(), 10)) {
+			if (part <= options.bound)
+				result.push_back(part);
+			else
+				cofactor *= part;
+			continue;
+		}
+
+		unsigned long k;
+		if (_perfectPower(part, b, root, k)) {
+			parts.insert(parts.end(), k, root);
+			continue;
+		}
+
+		// Retry with the next c as long as the walk only finds part itself
+		std::uint64_t partLeft = std::min(partBudget, budget);
+		RhoState state = rhoStart(options.x0, options.c);
+		for (factor = part; factor == part; ) {
+			std::uint64_t start = state.iterations;
+			factor = pollardRhoBrentResumable(part, state, partLeft).value;
+			// Backtracking after a gcd of n can take a few steps beyond the limit
+			std::uint64_t used = state.iterations - start;
+			partLeft -= std::min(used, partLeft);
+			budget -= std::min(used, budget);
+			if (factor == part)
+				state = rhoStart(options.x0, _nextC(part, options.x0, state.c));
+		}
+
+		if (factor == 1) {
+			cofactor *= part;
+			complete = false;
+			continue;
+		}
+		parts.push_back(factor);
+		parts.push_back(part / factor);
 	}
-}
\ No newline at end of file
+
+	return complete;
+}
+
+// Copies the factors found inside an arena scope into storage owned by the regular allocator
+static void copyFactors(const FactorResult& from, FactorResult& to) {
+	to.clear();
+	for (const mpz_class& factor : from) {
+		to.push_back(factor);
+	}
+}
+
+static void copyFactors(const Factorization& from, Factorization& to) {
+	to.clear();
+	for (const std::pair<mpz_class, unsigned long>& power : from) {
+		to.push_back(power.first, power.second);
+	}
+}
+
+template <typename Factors>
+void Factorize::_findFactors(const mpz_class& n, Factors& result, const FactorOptions& options) {
+	Trace::Span span("findFactors");
+	if (options.arena) {
+		// Every temporary of the factorization is bump allocated, only the result is copied out before the arena is reset
+		Arena::Scope scope;
+		Factors factors;
+		FactorOptions arenaOptions = options;
+		arenaOptions.arena = false;
+		_findFactors(n, factors, arenaOptions);
+
+		Arena::Suspend suspend;
+		copyFactors(factors, result);
+		return;
+	}
+
+	result.clear();
+
+	if (n == 0 || n == 1)
+		return;
+
+	// Find factors below bound b (the sign of n is dropped)
+	mpz_class cofactor = abs(n);
+	_removeSmallFactors(result, cofactor, options.b);
+
+	if (cofactor == 1)
+		return;
+
+	// Find product of all factors with an s-powersmooth predecessor
+	mpz_class factor = pollardPOne(cofactor, options.s).value;
+
+	// p = 1 (mod m) for every factor p makes x^(2k) + c with 2k = lcm(2, m) the best map of that form
+	const IterationMap* map = &options.map;
+	IterationMap hinted;
+	if (options.congruence > 2) {
+		hinted.exponent = options.congruence % 2 == 0 ? options.congruence : 2 * options.congruence;
+		map = &hinted;
+	}
+
+	if (factor != cofactor && factor != 1) {
+		_getAllFactors(result, factor, options.b, options.x0, options.c, options.pRho, *map, options.retry, options.seed);
+		cofactor /= factor;
+	}
+
+	// Find all remaining factors
+	_getAllFactors(result, cofactor, options.b, options.x0, options.c, options.pRho, *map, options.retry, options.seed);
+}
+
+void Factorization::push_back(const mpz_class& prime, unsigned long exponent) {
+	// Few distinct primes, so a sorted vector beats any node based container
+	auto power = std::lower_bound(powers.begin(), powers.end(), prime, [](const std::pair<mpz_class, unsigned long>& p1, const mpz_class& p2) { return p1.first < p2; });
+	if (power != powers.end() && power->first == prime)
+		power->second += exponent;
+	else
+		powers.insert(power, std::make_pair(prime, exponent));
+}
+
+mpz_class Factorization::divisorCount() const {
+	mpz_class count = 1;
+	for (const std::pair<mpz_class, unsigned long>& power : powers) {
+		count *= power.second + 1;
+	}
+	return count;
+}
+
+mpz_class Factorization::sigma() const {
+	// Product of (p^(e + 1) - 1) / (p - 1)
+	mpz_class sum = 1;
+	mpz_class term;
+	for (const std::pair<mpz_class, unsigned long>& power : powers) {
+		mpz_pow_ui(term.get_mpz_t(), power.first.get_mpz_t(), power.second + 1);
+		term -= 1;
+		mpz_divexact(term.get_mpz_t(), term.get_mpz_t(), mpz_class(power.first - 1).get_mpz_t());
+		sum *= term;
+	}
+	return sum;
+}
+
+mpz_class Factorization::phi() const {
+	// Product of p^(e - 1) * (p - 1)
+	mpz_class totient = 1;
+	mpz_class term;
+	for (const std::pair<mpz_class, unsigned long>& power : powers) {
+		mpz_pow_ui(term.get_mpz_t(), power.first.get_mpz_t(), power.second - 1);
+		totient *= term * (power.first - 1);
+	}
+	return totient;
+}
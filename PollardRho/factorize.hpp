@@ -1,44 +1,254 @@
 #pragma once
 
 #include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <limits>
 #include <iostream>
 #include <numeric>
 #include <chrono>
 #include <map>
 
+#include <functional>
+#include <optional>
+#include <random>
+
 #include <gmpxx.h> // mpz_class https://gmplib.org/manual/C_002b_002b-Interface-General
-#include <mpreal.h> // mpfr::mpreal https://github.com/advanpix/mpreal
 //#include <mpir.h> // wrapped by mpz_class for C++
 
-#include <gnuplot-iostream.h>
-#include <fstream>
-
 #include <boost/parameter/keyword.hpp>
 #include <boost/parameter/name.hpp>
 #include <boost/parameter/preprocessor.hpp>
 
 struct Result {
 	mpz_class value;
-	mpz_class gcdEvaluations;
-	mpz_class iterations;
+	std::uint64_t gcdEvaluations;
+	std::uint64_t iterations;
 	std::chrono::microseconds elapsed;
 };
 
 enum class PollardRho { Floyd, FloydImproved, Brent };
 
+// Complete state of a running (resumable) Brent walk, so it can be serialized and continued later
+struct RhoState {
+	mpz_class x0;
+	mpz_class c;
+	mpz_class x; // Current value of the walk
+	mpz_class xSave; // Value saved at the last power of two, which x is compared against
+	mpz_class xProduct; // Value of the walk when the current product was started, to backtrack to if its gcd is n
+	mpz_class product; // Accumulated product of differences since the last gcd
+	std::uint64_t productSize;
+	std::uint64_t powerOfTwo;
+	std::uint64_t iterations;
+	std::uint64_t gcdEvaluations;
+};
+
 inline mpz_class f(const mpz_class& x, const mpz_class& c) { return x * x + c; }
 
-Result pollardRhoFloyd(const mpz_class& n, const mpz_class& x0, const mpz_class& c);
-Result pollardRhoFloydImproved(const mpz_class& n, const mpz_class& x0, const mpz_class& c);
-Result pollardRhoBrent(const mpz_class& n, const mpz_class& x0, const mpz_class& c);
-Result pollardRhoBrentImproved(const mpz_class& n, const mpz_class& x0, const mpz_class& c);
+// Iteration map x -> g(x) mod n of the Pollard Rho walks, x^2 + c unless configured otherwise
+struct IterationMap {
+	// x^exponent + c. An even exponent 2k shortens the walk by a factor of about sqrt(gcd(p - 1, 2k) - 1) for prime factors p = 1 (mod 2k), at the cost of log2(2k) squarings per step
+	unsigned long exponent = 2;
+	std::function<mpz_class(const mpz_class& x, const mpz_class& c)> custom; // Any other map, replaces x^exponent + c if set
+
+	void apply(mpz_class& x, const mpz_class& c, const mpz_class& n) const {
+		if (custom) {
+			x = custom(x, c) % n;
+		}
+		else if (exponent == 2) {
+			x = f(x, c) % n;
+		}
+		else {
+			mpz_powm_ui(x.get_mpz_t(), x.get_mpz_t(), exponent, n.get_mpz_t());
+			x = (x + c) % n;
+		}
+	}
+
+	// Whether the walk from x0 is stuck from the start: x0 or its successor is a fixed point (for x^2 + c, c = -x0 * (x0 +- 1) mod n), or c makes the map degenerate (0 for x^exponent + c, -2 for x^2 + c as well)
+	bool stalls(const mpz_class& x0, const mpz_class& c, const mpz_class& n) const {
+		if (!custom && (c % n == 0 || (exponent == 2 && (c + 2) % n == 0)))
+			return true;
+		mpz_class x1 = x0 % n;
+		apply(x1, c, n);
+		if (x1 == x0 % n)
+			return true;
+		mpz_class x2 = x1;
+		apply(x2, c, n);
+		return x2 == x1;
+	}
+};
+
+// mpz_class only converts from and to unsigned long, which is 32 bits on Windows. Negative values become 0, values beyond 64 bits saturate
+inline std::uint64_t toUInt64(const mpz_class& n) {
+	if (n < 0)
+		return 0;
+	if (n.fits_ulong_p())
+		return n.get_ui();
+	if (mpz_sizeinbase(n.get_mpz_t(), 2) > 64)
+		return std::numeric_limits<std::uint64_t>::max();
+	mpz_class high = n >> 32;
+	mpz_class low = n - (high << 32);
+	return (std::uint64_t(high.get_ui()) << 32) | low.get_ui();
+}
+
+inline mpz_class fromUInt64(std::uint64_t n) {
+	mpz_class result = static_cast<unsigned long>(n >> 32);
+	result <<= 32;
+	result += static_cast<unsigned long>(n & 0xffffffff);
+	return result;
+}
+
+Result pollardRhoFloyd(const mpz_class& n, const mpz_class& x0, const mpz_class& c, const IterationMap& map = IterationMap());
+Result pollardRhoFloydImproved(const mpz_class& n, const mpz_class& x0, const mpz_class& c, const IterationMap& map = IterationMap());
+Result pollardRhoBrent(const mpz_class& n, const mpz_class& x0, const mpz_class& c, const IterationMap& map = IterationMap());
+Result pollardRhoBrentImproved(const mpz_class& n, const mpz_class& x0, const mpz_class& c, const IterationMap& map = IterationMap());
+
+RhoState rhoStart(const mpz_class& x0, const mpz_class& c);
+Result pollardRhoBrentResumable(const mpz_class& n, RhoState& state, std::uint64_t maxIterations);
 
 Result pollardPOne(const mpz_class& n, const mpz_class& s);
 
+// How a new walk is chosen after Pollard Rho only found n itself: the next usable c, or a random (x0, c)
+enum class Retry { Linear, Random };
+
+// Reproducible source of random (x0, c) pairs for the retries on one n: the stream only depends on n and the seed, not on the thread or on earlier calls
+class RetryStream {
+public:
+	RetryStream(const mpz_class& n, std::uint64_t seed);
+
+	// Marks c as failed, so it's never drawn again for this n
+	void exclude(const mpz_class& c);
+
+	// Draws a new pair, skipping the c that stall the walk from the drawn x0 under map (see IterationMap::stalls) or are excluded
+	void next(mpz_class& x0, mpz_class& c, const IterationMap& map = IterationMap());
+
+private:
+	mpz_class n;
+	std::mt19937_64 generator;
+	std::vector<mpz_class> excluded;
+};
+
+// Options of Factorize::findFactors, see the keyword version for their meaning
+struct FactorOptions {
+	mpz_class b = 1699;
+	mpz_class s = 2000;
+	mpz_class x0 = 2;
+	mpz_class c = 1;
+	PollardRho pRho = PollardRho::FloydImproved;
+	unsigned long congruence = 0; // Hint that every prime factor p of n is 1 (mod congruence), e.g. 2q for 2^q - 1, which switches the walk to x^(2k) + c with 2k = lcm(2, congruence)
+	IterationMap map; // Iteration map of the Pollard Rho walks, unless congruence is set
+	Retry retry = Retry::Linear;
+	std::uint64_t seed = 0; // Seed of the RetryStream for Retry::Random
+	bool arena = false; // Allocate GMP temporaries from a thread local arena that is reset after the call, requires Arena::install()
+};
+
+// Options of Factorize::findSmoothFactors
+struct SmoothOptions {
+	mpz_class bound = 1000000; // B, only prime factors up to B are searched for
+	mpz_class b = 1699; // Bound for trial division (never beyond B)
+	mpz_class s = 2000; // Bound for Pollard p - 1 (never beyond B)
+	std::uint64_t budget = 1000000; // Pollard Rho (Brent) iterations spent on all parts of n together
+	mpz_class x0 = 2;
+	mpz_class c = 1;
+};
+
+// Output of Factorize::findFactors that can be reused across calls: clear() keeps every mpz_class (and its limbs) allocated, so factoring into the same FactorResult again only overwrites them
+class FactorResult {
+public:
+	FactorResult() = default;
+	FactorResult(const FactorResult&) = delete;
+	FactorResult& operator=(const FactorResult&) = delete;
+	FactorResult(FactorResult&&) = default;
+	FactorResult& operator=(FactorResult&&) = default;
+
+	void clear() {
+		count = 0;
+		cofactor = 1;
+	}
+
+	void push_back(const mpz_class& factor) {
+		if (count < factors.size())
+			factors[count] = factor;
+		else
+			factors.push_back(factor);
+		count++;
+	}
+
+	size_t size() const { return count; }
+	bool empty() const { return count == 0; }
+	const mpz_class& operator[](size_t i) const { return factors[i]; }
+	std::vector<mpz_class>::const_iterator begin() const { return factors.begin(); }
+	std::vector<mpz_class>::const_iterator end() const { return factors.begin() + count; }
+
+	mpz_class cofactor = 1; // The part of n left unfactored by Factorize::findSmoothFactors, always 1 after Factorize::findFactors
+
+private:
+	std::vector<mpz_class> factors;
+	size_t count = 0;
+};
+
+// Prime factorization as (prime, exponent) pairs sorted by prime, merged as factors are found
+class Factorization {
+public:
+	void clear() { powers.clear(); }
+
+	void push_back(const mpz_class& prime, unsigned long exponent = 1);
+
+	size_t size() const { return powers.size(); }
+	bool empty() const { return powers.empty(); }
+	const std::pair<mpz_class, unsigned long>& operator[](size_t i) const { return powers[i]; }
+	std::vector<std::pair<mpz_class, unsigned long>>::const_iterator begin() const { return powers.begin(); }
+	std::vector<std::pair<mpz_class, unsigned long>>::const_iterator end() const { return powers.end(); }
+
+	mpz_class divisorCount() const; // Number of divisors
+	mpz_class sigma() const; // Sum of divisors
+	mpz_class phi() const; // Euler's totient
+
+private:
+	std::vector<std::pair<mpz_class, unsigned long>> powers;
+};
+
 namespace Factorize {
-	void _removeSmallFactors(std::vector<mpz_class>& factors, mpz_class& n, const mpz_class& b);
+	// Factors is std::vector<mpz_class>, FactorResult or Factorization
+	template <typename Factors>
+	void _removeSmallFactors(Factors& factors, mpz_class& n, const mpz_class& b);
+
+	mpz_class _nextC(const mpz_class& n, const mpz_class& x0, const mpz_class& c, const IterationMap& map = IterationMap());
+
+	// Moves (x0, c) on to the next walk after one that only found n. The stream is set up on the first random retry
+	void _retry(const mpz_class& n, mpz_class& x0, mpz_class& c, const IterationMap& map, Retry retry, std::uint64_t seed, std::optional<RetryStream>& stream);
+
+	// Checks if n = root^k for a prime k, assuming n has no factors below b
+	bool _perfectPower(const mpz_class& n, const mpz_class& b, mpz_class& root, unsigned long& k);
+
+	template <typename Factors>
+	void _getAllFactors(Factors& factors, mpz_class n, const mpz_class& b, const mpz_class& x0, const mpz_class& c, PollardRho pRho, const IterationMap& map = IterationMap(), Retry retry = Retry::Linear, std::uint64_t seed = 0);
 
-	void _getAllFactors(std::vector<mpz_class>& factors, mpz_class n, const mpz_class& b, const mpz_class& x0, const mpz_class& c, PollardRho pRho);
+	template <typename Factors>
+	void _findFactors(const mpz_class& n, Factors& result, const FactorOptions& options);
+
+	/** This function finds all prime factors of n, like the keyword version below, but writes them into a FactorResult that can be reused to avoid allocations.
+	 * @param n The number to factor
+	 * @param result Receives all prime factors of |n|, or |n| itself if it is prime (cleared first)
+	 * @param options The bounds, starting values and algorithm to use
+	 */
+	void findFactors(const mpz_class& n, FactorResult& result, const FactorOptions& options = FactorOptions());
+
+	/** This function finds the prime factorization of n as sorted (prime, exponent) pairs, without ever listing repeated primes one by one.
+	 * @param n The number to factor
+	 * @param result Receives the prime powers of |n| (cleared first)
+	 * @param options The bounds, starting values and algorithm to use
+	 */
+	void findFactors(const mpz_class& n, Factorization& result, const FactorOptions& options = FactorOptions());
+
+	/** This function only finds the prime factors of n up to options.bound, with trial division, a bounded Pollard p - 1 and Pollard Rho walks limited to options.budget iterations in total.
+	 * Parts of n that the budget doesn't cover are left in result.cofactor, so n is always the product of the factors and the cofactor (which carries the sign of n).
+	 * @param n The number to factor
+	 * @param result Receives the prime factors up to the bound (cleared first), and the rest of n as result.cofactor
+	 * @param options The bound, the bounds of the individual stages and the iteration budget
+	 * @result true if the cofactor certainly has no prime factor up to the bound, false if the budget ran out or a part was given up on before that was certain
+	 */
+	bool findSmoothFactors(const mpz_class& n, FactorResult& result, const SmoothOptions& options = SmoothOptions());
 
 	namespace keywords {
 		BOOST_PARAMETER_NAME(n)
@@ -77,28 +287,14 @@ namespace Factorize {
 		)
 	)
 	{
-		std::vector<mpz_class> factors;
-
-		if (n == 0 || n == 1)
-			return factors;
-
-		// Find factors below bound b
-		_removeSmallFactors(factors, n, b);
-
-		if (n == 1)
-			return factors;
-
-		// Find product of all factors with an s-powersmooth predecessor
-		mpz_class factor = pollardPOne(n, s).value;
-
-		if (factor != n && factor != 1) {
-			_getAllFactors(factors, factor, b, x0, c, pRho);
-			n /= factor;
-		}
-
-		// Find all remaining factors
-		_getAllFactors(factors, n, b, x0, c, pRho);
-
-		return factors;
+		FactorResult result;
+		FactorOptions options;
+		options.b = b;
+		options.s = s;
+		options.x0 = x0;
+		options.c = c;
+		options.pRho = pRho;
+		findFactors(n, result, options);
+		return std::vector<mpz_class>(result.begin(), result.end());
 	}
 }
\ No newline at end of file
@@ -1,4 +1,7 @@
 #include "test.hpp"
+#include "checkpoint.hpp"
+#include "arena.hpp"
+#include "trace.hpp"
 
 using namespace Factorize::keywords;
 
@@ -7,32 +10,32 @@ void displayBasics() {
 
 	std::cout << "Primes are allowed, but they'll take longer than normal: O(sqrt(n)) instead of O(sqrt(p)), and leave you uncertain if the algorithm failed." << std::endl;
 	factor = pollardRhoFloyd(23, 2, 1);
-	std::cout << "Factoring 23: " << factor.value.get_str() << ", gcd evaluations: " << factor.gcdEvaluations.get_str() << std::endl << std::endl;
+	std::cout << "Factoring 23: " << factor.value.get_str() << ", gcd evaluations: " << factor.gcdEvaluations << std::endl << std::endl;
 
 	std::cout << "Perfect powers are allowed but unfactorizable, all the factors are the same, so they all collide at the same time, meaning N is always found." << std::endl;
 	factor = pollardRhoFloyd(8, 2, 1);
-	std::cout << "Factoring 8: " << factor.value.get_str() << ", gcd evaluations: " << factor.gcdEvaluations.get_str() << std::endl << std::endl;
+	std::cout << "Factoring 8: " << factor.value.get_str() << ", gcd evaluations: " << factor.gcdEvaluations << std::endl << std::endl;
 
 	std::cout << "This obviously still holds when perfect powers are multiplied with additional different factors, you'll never be able to find the root of the perfect power as a factor,"
 		"yet the likelihood of finding the perfect power is governed by its root" << std::endl << std::endl;
 	factor = pollardRhoFloyd(8 * 3, 2, 1);
-	std::cout << "Factoring 8 * 3, x0 = 2, c = 1: " << factor.value.get_str() << ", gcd evaluations: " << factor.gcdEvaluations.get_str() << std::endl << std::endl; // here we find 3
+	std::cout << "Factoring 8 * 3, x0 = 2, c = 1: " << factor.value.get_str() << ", gcd evaluations: " << factor.gcdEvaluations << std::endl << std::endl; // here we find 3
 	factor = pollardRhoFloyd(8 * 3, 2, 2);
-	std::cout << "Factoring 8 * 3, x0 = 2, c = 2: " << factor.value.get_str() << ", gcd evaluations: " << factor.gcdEvaluations.get_str() << std::endl << std::endl; // here we find 8
+	std::cout << "Factoring 8 * 3, x0 = 2, c = 2: " << factor.value.get_str() << ", gcd evaluations: " << factor.gcdEvaluations << std::endl << std::endl; // here we find 8
 	factor = pollardRhoFloyd(8 * 3, 2, 3);
-	std::cout << "Factoring 8 * 3, x0 = 2, c = 3: " << factor.value.get_str() << ", gcd evaluations: " << factor.gcdEvaluations.get_str() << std::endl << std::endl; // here we find 8
+	std::cout << "Factoring 8 * 3, x0 = 2, c = 3: " << factor.value.get_str() << ", gcd evaluations: " << factor.gcdEvaluations << std::endl << std::endl; // here we find 8
 }
 
 void runPollardRho(mpz_class p, mpz_class q, mpz_class x0, mpz_class c) {
 	Result factor;
 	factor = pollardRhoFloyd(p * q, x0, c);
-	std::cout << factor.value.get_str() << ", gcd evaluations: " << factor.gcdEvaluations.get_str() << ", iterations: " << factor.iterations.get_str() << ", elapsed: " << factor.elapsed.count() << std::endl;
+	std::cout << factor.value.get_str() << ", gcd evaluations: " << factor.gcdEvaluations << ", iterations: " << factor.iterations << ", elapsed: " << factor.elapsed.count() << std::endl;
 	factor = pollardRhoFloydImproved(p * q, x0, c);
-	std::cout << factor.value.get_str() << ", gcd evaluations: " << factor.gcdEvaluations.get_str() << ", iterations: " << factor.iterations.get_str() << ", elapsed: " << factor.elapsed.count() << std::endl;
+	std::cout << factor.value.get_str() << ", gcd evaluations: " << factor.gcdEvaluations << ", iterations: " << factor.iterations << ", elapsed: " << factor.elapsed.count() << std::endl;
 	factor = pollardRhoBrent(p * q, x0, c);
-	std::cout << factor.value.get_str() << ", gcd evaluations: " << factor.gcdEvaluations.get_str() << ", iterations: " << factor.iterations.get_str() << ", elapsed: " << factor.elapsed.count() << std::endl;
+	std::cout << factor.value.get_str() << ", gcd evaluations: " << factor.gcdEvaluations << ", iterations: " << factor.iterations << ", elapsed: " << factor.elapsed.count() << std::endl;
 	factor = pollardRhoBrentImproved(p * q, x0, c);
-	std::cout << factor.value.get_str() << ", gcd evaluations: " << factor.gcdEvaluations.get_str() << ", iterations: " << factor.iterations.get_str() << ", elapsed: " << factor.elapsed.count() << std::endl;
+	std::cout << factor.value.get_str() << ", gcd evaluations: " << factor.gcdEvaluations << ", iterations: " << factor.iterations << ", elapsed: " << factor.elapsed.count() << std::endl;
 }
 
 void testMod() {
@@ -59,6 +62,133 @@ void testMod() {
 	std::cout << "Elapsed time: " << elapsed.count() << " [microseconds]" << std::endl;
 }
 
+void testCounters() {
+	mpz_class mpzIteration = 0;
+	volatile std::uint64_t nativeIteration = 0; // volatile, so the loop isn't folded into a single addition
+
+	std::chrono::steady_clock::time_point begin, end;
+
+	begin = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < 100000000; i++) {
+		mpzIteration += 3;
+	}
+	end = std::chrono::steady_clock::now();
+	auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
+	std::cout << "mpz_class counter: " << elapsed.count() << " [microseconds]" << std::endl;
+
+	begin = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < 100000000; i++) {
+		nativeIteration = nativeIteration + 3;
+	}
+	end = std::chrono::steady_clock::now();
+	elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
+	std::cout << "std::uint64_t counter: " << elapsed.count() << " [microseconds]" << std::endl;
+
+	// Per-iteration cost of the kernels themselves, which only spend time on the walk now
+	mpz_class n = mpz_class("5915587277") * mpz_class("3267000013");
+	std::vector<std::pair<std::string, Result>> results = {
+		{ "Floyd", pollardRhoFloyd(n, 2, 1) },
+		{ "FloydImproved", pollardRhoFloydImproved(n, 2, 1) },
+		{ "Brent", pollardRhoBrent(n, 2, 1) },
+		{ "BrentImproved", pollardRhoBrentImproved(n, 2, 1) }
+	};
+	for (const std::pair<std::string, Result>& result : results) {
+		std::cout << result.first << ": " << double(result.second.elapsed.count()) * 1000 / result.second.iterations << " [nanoseconds per iteration]" << std::endl;
+	}
+}
+
+void testTrace() {
+	// Cost of reading the clock, which every kernel does twice per call
+	const size_t reads = 10000000;
+	volatile std::uint64_t sink = 0;
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < reads; i++) {
+		sink = sink + std::chrono::steady_clock::now().time_since_epoch().count();
+	}
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	std::cout << "steady_clock::now(): " << std::chrono::duration<double, std::nano>(end - begin).count() / reads << " [nanoseconds]" << std::endl;
+
+	begin = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < reads; i++) {
+		sink = sink + Trace::now();
+	}
+	end = std::chrono::steady_clock::now();
+	std::cout << "Trace::now(): " << std::chrono::duration<double, std::nano>(end - begin).count() / reads << " [nanoseconds]" << std::endl;
+
+	// Every stage of a single factorization, viewable in chrome://tracing or ui.perfetto.dev
+	Trace::enable();
+	FactorResult result;
+	Factorize::findFactors(mpz_class("5915587277") * mpz_class("3267000013") * mpz_class("1000003") * mpz_class("1000003") * 1024 * 3 * 3 * 1697, result);
+	Trace::enable(false);
+	if (Trace::write("trace.json"))
+		std::cout << "Trace of " << result.size() << " factors written to trace.json" << std::endl;
+	Trace::clear();
+}
+
+void testIterationMaps() {
+	// Prime factors of 2^q - 1 are 1 (mod 2q), those of 2^(2^m) + 1 are 1 (mod 2^(m + 2))
+	// Only inputs whose factors GMP proves prime, a probable prime cofactor (as in M101 or F7) is given 5 walks of O(sqrt(p)) iterations each before it's accepted
+	std::vector<std::pair<std::string, std::pair<mpz_class, unsigned long>>> inputs = {
+		{ "M59", { (mpz_class(1) << 59) - 1, 118 } },
+		{ "M67", { (mpz_class(1) << 67) - 1, 134 } },
+		{ "M71", { (mpz_class(1) << 71) - 1, 142 } },
+		{ "M73", { (mpz_class(1) << 73) - 1, 146 } },
+		{ "M79", { (mpz_class(1) << 79) - 1, 158 } },
+		{ "F6", { (mpz_class(1) << 64) + 1, 256 } }
+	};
+	for (const std::pair<std::string, std::pair<mpz_class, unsigned long>>& input : inputs) {
+		for (unsigned long congruence : { 0ul, input.second.second }) {
+			FactorOptions options;
+			options.pRho = PollardRho::Brent;
+			options.congruence = congruence;
+			Trace::Span span("testIterationMaps");
+			FactorResult result;
+			Factorize::findFactors(input.second.first, result, options);
+			std::cout << input.first << (congruence ? " x^" + std::to_string(congruence) : std::string(" x^2")) << " + c:";
+			for (const mpz_class& factor : result) {
+				std::cout << " " << factor.get_str();
+			}
+			std::cout << ", " << span.elapsed().count() << " [microseconds]" << std::endl;
+		}
+	}
+}
+
+void testArena() {
+	// Small inputs, where the factorization is dominated by short lived temporaries rather than by multiplication
+	const size_t count = 200000;
+	mpz_class start = mpz_class("1000000000000");
+	FactorResult result;
+	size_t mismatches = 0;
+	std::vector<mpz_class> expected;
+
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < count; i++) {
+		Factorize::findFactors(start + static_cast<unsigned long>(i), result);
+		expected.insert(expected.end(), result.begin(), result.end());
+	}
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
+	std::cout << "malloc: " << elapsed.count() << " [microseconds]" << std::endl;
+
+	Arena::install();
+	FactorOptions options;
+	options.arena = true;
+	size_t j = 0;
+	begin = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < count; i++) {
+		Factorize::findFactors(start + static_cast<unsigned long>(i), result, options);
+		for (const mpz_class& factor : result) {
+			if (j >= expected.size() || factor != expected[j++])
+				mismatches++;
+		}
+	}
+	end = std::chrono::steady_clock::now();
+	Arena::uninstall();
+	elapsed = std::chrono::duration_cast<std::chrono::microseconds>(end - begin);
+	std::cout << "arena: " << elapsed.count() << " [microseconds]" << std::endl;
+	std::cout << "Mismatches: " << mismatches << std::endl;
+}
+
 int main() {
 	
 	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
@@ -99,6 +229,14 @@ int main() {
 
 	//testMod();
 
+	//testCounters();
+
+	//testArena();
+
+	//testIterationMaps();
+
+	//testTrace();
+
 	//testPollardRhoRuntime(10000, 10000000);
 
 	/*
@@ -129,7 +267,7 @@ int main() {
 	//factor = pollardPOne(mpz_class("335283916003206474733644480356983247998164827732269"), 14346);
 	//factor = pollardPOne(59 * 73 * 7 * 13, 10);
 	factor = pollardPOne(405, 10);
-	std::cout << factor.value.get_str() << ", gcd evaluations: " << factor.gcdEvaluations.get_str() << ", iterations: " << factor.iterations.get_str() << ", elapsed: " << factor.elapsed.count() << std::endl;
+	std::cout << factor.value.get_str() << ", gcd evaluations: " << factor.gcdEvaluations << ", iterations: " << factor.iterations << ", elapsed: " << factor.elapsed.count() << std::endl;
 	std::vector<mpz_class> factors = Factorize::findFactors(factor.value);
 	//std::vector<mpz_class> factors = Factorize::findFactors(factor.value - 1);
 	for (const mpz_class& f : factors) {
@@ -141,8 +279,13 @@ int main() {
 	}
 	*/
 
+	//std::vector<mpz_class> factors = Checkpoint::findFactors(mpz_class("47519791211") * mpz_class("57911131517"), "../checkpoint.txt"); // Kill and rerun with the line below to continue where it left off
+	//std::vector<mpz_class> factors = Checkpoint::resume("../checkpoint.txt");
+
 	//comparePollardRho(100000000000);
 
+	//testRetryStrategies(10000000, 200);
+
 	//runPollardRho(59, 73, 2, 1);
 	//runPollardRho(59, 73, 2, -1);
 	//runPollardRho(328511, 328513, 2, 1);
@@ -155,11 +298,11 @@ int main() {
 	//testPollardFactor(3 * 59 * 73);
 	//testPollardFactor(13 * 59 * 73);
 
-	//std::cout << findCollision(2209, 2, -6) << std::endl; // this is stupid
-	//std::cout << findCollision(2209, 2, 2203) << std::endl; // this is lucky (don't do this for N though! only works for p)
+	//std::cout << findCollision<std::uint32_t>(2209, 2, -6).iterations << std::endl; // this is stupid
+	//std::cout << findCollision<std::uint32_t>(2209, 2, 2203).iterations << std::endl; // this is lucky (don't do this for N though! only works for p)
 	
-	//std::cout << findCollision(2209, 2, -2) << std::endl; // this is stupid
-	//std::cout << findCollision(2209, 2, 2207) << std::endl; // this is lucky (don't do this for N though! only works for p)
+	//std::cout << findCollision<std::uint32_t>(2209, 2, -2).iterations << std::endl; // this is stupid
+	//std::cout << findCollision<std::uint32_t>(2209, 2, 2207).iterations << std::endl; // this is lucky (don't do this for N though! only works for p)
 
 	//std::cout << pollardRhoFloyd(2209 * 5, 2, 2207).get_str() << std::endl; // here's being lucky in action: 2209 is always found in 1 iteration
 	//std::cout << pollardRhoFloyd(2209 * 5, 2, -2).get_str() << std::endl; // here's begin stupid in action: 2209 * 5 is always found in 1 iteration
@@ -0,0 +1,139 @@
+#include "parallel.hpp"
+#include "trace.hpp"
+
+#include <sstream>
+#include <string>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// Collisions only happen mod the unknown factor p, so there is no way to tell a distinguished point mod p from x mod N (which is what van Oorschot-Wiener rely on for discrete logarithms).
+// The workers therefore walk independently on different constants c, and the coordinator simply takes the first nontrivial gcd any of them reports
+Result Parallel::pollardRho(const mpz_class& n, const mpz_class& x0, const mpz_class& c, unsigned int workers, std::uint64_t reportIterations) {
+	Trace::Span span("Parallel::pollardRho");
+
+	if (workers == 0 || mpz_probab_prime_p(n.get_mpz_t(), 10)) {
+		return { n, 0, 0, std::chrono::microseconds(0) };
+	}
+
+	std::vector<pid_t> pids;
+	std::vector<pollfd> sockets;
+	mpz_class cWorker = c;
+	for (unsigned int i = 0; i < workers; i++, cWorker = Factorize::_nextC(n, x0, cWorker)) {
+		int pair[2];
+		if (socketpair(AF_UNIX, SOCK_STREAM, 0, pair) != 0) {
+			std::cout << "Failed to create socket for worker " << i << "." << std::endl;
+			break;
+		}
+
+		pid_t pid = fork();
+		if (pid == 0) {
+			close(pair[0]);
+			for (const pollfd& socket : sockets) {
+				close(socket.fd);
+			}
+			_worker(pair[1], n, x0, cWorker, workers, reportIterations);
+			_exit(0);
+		}
+
+		close(pair[1]);
+		if (pid < 0) {
+			std::cout << "Failed to start worker " << i << "." << std::endl;
+			close(pair[0]);
+			break;
+		}
+		pids.push_back(pid);
+		sockets.push_back({ pair[0], POLLIN, 0 });
+	}
+
+	mpz_class d = n;
+	std::vector<std::string> buffers(sockets.size());
+	std::vector<std::pair<std::uint64_t, std::uint64_t>> progress(sockets.size(), std::make_pair(0, 0)); // gcd evaluations, iterations
+	for (size_t open = sockets.size(); open && d == n;) {
+		if (poll(sockets.data(), sockets.size(), -1) < 0) {
+			break;
+		}
+
+		for (size_t i = 0; i < sockets.size() && d == n; i++) {
+			if (!sockets[i].revents) {
+				continue;
+			}
+
+			char data[4096];
+			ssize_t size = read(sockets[i].fd, data, sizeof(data));
+			if (size <= 0) {
+				close(sockets[i].fd);
+				sockets[i].fd = -1; // poll() ignores negative descriptors
+				open--;
+				continue;
+			}
+			buffers[i].append(data, size);
+
+			// Every report is a line "<gcd evaluations> <iterations> <gcd in hex>"
+			for (size_t end = buffers[i].find('\n'); end != std::string::npos; end = buffers[i].find('\n')) {
+				std::istringstream report(buffers[i].substr(0, end));
+				buffers[i].erase(0, end + 1);
+
+				std::string gcd;
+				report >> progress[i].first >> progress[i].second >> gcd;
+				mpz_class value(gcd, 16);
+				if (value != 1 && value != n) {
+					d = value;
+					break;
+				}
+			}
+		}
+	}
+
+	for (size_t i = 0; i < pids.size(); i++) {
+		kill(pids[i], SIGKILL);
+		waitpid(pids[i], nullptr, 0);
+		if (sockets[i].fd >= 0) {
+			close(sockets[i].fd);
+		}
+	}
+
+	std::uint64_t gcdEvaluations = 0;
+	std::uint64_t iterations = 0;
+	for (const std::pair<std::uint64_t, std::uint64_t>& p : progress) {
+		gcdEvaluations += p.first;
+		iterations += p.second;
+	}
+
+	return { d, gcdEvaluations, iterations, span.elapsed() };
+}
+
+void Parallel::_worker(int socket, const mpz_class& n, const mpz_class& x0, mpz_class c, unsigned int workers, std::uint64_t reportIterations) {
+	std::uint64_t gcdEvaluations = 0;
+	std::uint64_t iterations = 0;
+
+	RhoState state = rhoStart(x0, c);
+	for (;;) {
+		Result factor = pollardRhoBrentResumable(n, state, reportIterations);
+
+		std::string report = std::to_string(gcdEvaluations + state.gcdEvaluations) + ' ' + std::to_string(iterations + state.iterations) + ' ' + factor.value.get_str(16) + '\n';
+		for (size_t written = 0; written < report.size();) {
+			ssize_t size = write(socket, report.data() + written, report.size() - written);
+			if (size <= 0) {
+				return; // The coordinator is gone
+			}
+			written += size;
+		}
+
+		if (factor.value == n) {
+			// Skip the constants the other workers are responsible for
+			gcdEvaluations += state.gcdEvaluations;
+			iterations += state.iterations;
+			for (unsigned int i = 0; i < workers; i++) {
+				c = Factorize::_nextC(n, x0, c);
+			}
+			state = rhoStart(x0, c);
+		}
+		else if (factor.value != 1) {
+			return;
+		}
+	}
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "factorize.hpp"
+
+namespace Parallel {
+	/** This function runs Pollard Rho (Brent) in several worker processes at once, each on its own constant c, and returns the first nontrivial factor any of them finds.
+	 * The workers are independent walks, not one walk split up, so N workers only cut the expected time to a factor by about sqrt(N).
+	 * Workers report their progress to this (coordinating) process over Unix sockets every reportIterations iterations. POSIX only.
+	 * @param n The composite number to factor (if n is probably prime, n is returned immediately)
+	 * @param x0 The initial value for every worker
+	 * @param c The constant of the first worker, the others continue with the next valid constants
+	 * @param workers The number of worker processes
+	 * @param reportIterations The number of iterations between two reports of a worker
+	 *
+	 * @result The factor found, with gcd evaluations and iterations summed over all workers
+	 */
+	Result pollardRho(const mpz_class& n, const mpz_class& x0, const mpz_class& c, unsigned int workers, std::uint64_t reportIterations = 100000);
+
+	void _worker(int socket, const mpz_class& n, const mpz_class& x0, mpz_class c, unsigned int workers, std::uint64_t reportIterations);
+}
@@ -0,0 +1,53 @@
+#include "parallel.hpp"
+#include "sieve.hpp"
+
+#include <chrono>
+#include <string>
+
+// Correctness check of Parallel::pollardRho: for every worker count from 1 to maxWorkers, each semiprime p * (p + 2) of twin primes up to maxN has to give back p or p + 2
+// Usage: pollardrho_parallel [maxN [maxWorkers]], exits with 1 if any semiprime fails. POSIX only, like Parallel::pollardRho
+
+static bool parseArgument(const char* str, std::uint64_t& value) {
+	mpz_class parsed;
+	if (parsed.set_str(str, 10) != 0 || parsed < 0 || mpz_sizeinbase(parsed.get_mpz_t(), 2) > 64) {
+		std::cout << str << ": not a number" << std::endl;
+		return false;
+	}
+	value = toUInt64(parsed);
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	std::uint64_t maxN = 10000000000;
+	std::uint64_t maxWorkers = 4;
+	if ((argc > 1 && !parseArgument(argv[1], maxN)) || (argc > 2 && !parseArgument(argv[2], maxWorkers)))
+		return 1;
+
+	size_t failures = 0;
+	for (unsigned int workers = 1; workers <= maxWorkers; workers++) {
+		size_t semiprimes = 0;
+		std::uint64_t iterations = 0;
+		std::chrono::microseconds elapsed(0);
+
+		PrimeSieve primes(toUInt64(sqrt(fromUInt64(maxN))) + 2);
+		for (std::uint64_t p1 = primes.next(), p2 = primes.next(); p2 && p1 <= maxN / p2; p1 = p2, p2 = primes.next()) {
+			if (p2 - p1 != 2)
+				continue;
+
+			mpz_class n = fromUInt64(p1) * fromUInt64(p2);
+			Result res = Parallel::pollardRho(n, 2, 1, workers);
+			semiprimes++;
+			if (res.value != fromUInt64(p1) && res.value != fromUInt64(p2)) {
+				failures++;
+				std::cout << "	No factor found for " << n.get_str() << " = " << p1 << " * " << p2 << " with " << workers << " workers, got " << res.value.get_str() << std::endl;
+			}
+			iterations += res.iterations;
+			elapsed += res.elapsed;
+		}
+
+		std::cout << "Workers: " << workers << ", semiprimes: " << semiprimes << ", total iterations: " << iterations << ", elapsed: " << elapsed.count() << " [microseconds]" << std::endl;
+	}
+	std::cout << "Failures: " << failures << std::endl;
+
+	return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,205 @@
+#include "factorize.hpp"
+#include "arena.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+
+// Property and differential check of the whole factorization: factors random and structured inputs (semiprimes, prime powers, smooth numbers, factors with a smooth p - 1, edge cases) on several threads and checks that the factors are prime and multiply to |n|, and that all variants of findFactors agree. Case i only depends on seed and i
+// Usage: pollardrho_properties [cases [threads [seed]]], exits with 1 if any case fails
+
+static mpz_class randomPrime(std::mt19937_64& generator, unsigned int bits) {
+	mpz_class p = fromUInt64(generator() >> (64 - bits));
+	mpz_nextprime(p.get_mpz_t(), p.get_mpz_t());
+	return p;
+}
+
+// Input number i of the property check
+static mpz_class propertyCase(std::uint64_t i, std::mt19937_64& generator) {
+	static const std::vector<mpz_class> edgeCases = {
+		0, 1, 2, 3, 4, -1, -2, -12, -1000003, 1697, 1699, 1709, 1699 * 1699, 1699 * 1709, 1709 * 1709, mpz_class(1709) * 1709 * 1709,
+		mpz_class("4294967291"), mpz_class("4294967296"), mpz_class("18446744073709551615"), mpz_class("18446744073709551616"), mpz_class("18446744073709551617")
+	};
+	if (i < edgeCases.size())
+		return edgeCases[i];
+
+	mpz_class n = 1;
+	switch (i % 7) {
+	case 0: // Random, up to 48 bits
+		return fromUInt64(generator() >> (16 + generator() % 46)) + 1;
+	case 1: // Semiprime
+		return randomPrime(generator, 8 + generator() % 19) * randomPrime(generator, 8 + generator() % 19);
+	case 2: { // Prime power, sometimes of a composite
+		mpz_class root = randomPrime(generator, 2 + generator() % 15);
+		if (generator() % 4 == 0)
+			root *= randomPrime(generator, 2 + generator() % 10);
+		mpz_pow_ui(n.get_mpz_t(), root.get_mpz_t(), 2 + generator() % 5);
+		return n;
+	}
+	case 3: // Smooth, every factor below 1000
+		for (unsigned int k = 1 + generator() % 12; k; k--)
+			n *= randomPrime(generator, 2 + generator() % 9) % 1000;
+		return n;
+	case 4: { // A factor p with a smooth p - 1 (found by Pollard p - 1) times a large prime
+		mpz_class p;
+		do {
+			p = 2;
+			for (unsigned int k = 2 + generator() % 4; k; k--)
+				p *= randomPrime(generator, 2 + generator() % 9) % 1500;
+			p += 1;
+		} while (!mpz_probab_prime_p(p.get_mpz_t(), 25));
+		return p * randomPrime(generator, 10 + generator() % 21);
+	}
+	case 5: // Small factors times a large prime
+		return randomPrime(generator, 2 + generator() % 10) * randomPrime(generator, 2 + generator() % 10) * randomPrime(generator, 20 + generator() % 21);
+	default: // Negative
+		return -(fromUInt64(generator() >> (24 + generator() % 38)) + 2);
+	}
+}
+
+// Checks a single input, and returns a description of the first violated property (empty if there is none)
+static std::string checkProperties(const mpz_class& n, std::uint64_t seed, FactorResult& result, FactorResult& compare, Factorization& factorization) {
+	mpz_class absN = abs(n);
+
+	// Every factor is prime and the factors multiply to |n|
+	FactorOptions options;
+	Factorize::findFactors(n, result, options);
+	mpz_class product = 1;
+	for (const mpz_class& factor : result) {
+		if (mpz_probab_prime_p(factor.get_mpz_t(), 25) == 0)
+			return "composite factor " + factor.get_str();
+		product *= factor;
+	}
+	if (absN > 1 && product != absN)
+		return "product " + product.get_str();
+	if (absN <= 1 && !result.empty())
+		return "factors of 0 or 1";
+
+	std::vector<mpz_class> sorted(result.begin(), result.end());
+	std::sort(sorted.begin(), sorted.end());
+	auto matches = [&sorted](const FactorResult& other) {
+		std::vector<mpz_class> otherSorted(other.begin(), other.end());
+		std::sort(otherSorted.begin(), otherSorted.end());
+		return otherSorted == sorted;
+	};
+
+	// Every Pollard Rho variant, the random retries and the arena find the same factors
+	for (PollardRho pRho : { PollardRho::Floyd, PollardRho::FloydImproved, PollardRho::Brent }) {
+		FactorOptions variant;
+		variant.pRho = pRho;
+		Factorize::findFactors(n, compare, variant);
+		if (!matches(compare))
+			return "PollardRho variant " + std::to_string(static_cast<int>(pRho));
+	}
+	FactorOptions random;
+	random.retry = Retry::Random;
+	random.seed = seed;
+	Factorize::findFactors(n, compare, random);
+	if (!matches(compare))
+		return "Retry::Random";
+	if (Arena::installed()) {
+		FactorOptions arena;
+		arena.arena = true;
+		Factorize::findFactors(n, compare, arena);
+		if (!matches(compare))
+			return "arena";
+	}
+	if (result.cofactor != 1 || compare.cofactor != 1)
+		return "cofactor left by findFactors";
+
+	// The prime powers expand to the same factors
+	Factorize::findFactors(n, factorization, options);
+	std::vector<mpz_class> expanded;
+	for (const std::pair<mpz_class, unsigned long>& power : factorization) {
+		expanded.insert(expanded.end(), power.second, power.first);
+	}
+	if (expanded != sorted)
+		return "Factorization";
+
+	// Each kernel on its own returns a divisor of a composite n
+	if (absN > 3 && mpz_probab_prime_p(absN.get_mpz_t(), 25) == 0 && mpz_sizeinbase(absN.get_mpz_t(), 2) <= 40) {
+		for (Result (*kernel)(const mpz_class&, const mpz_class&, const mpz_class&, const IterationMap&) : { pollardRhoFloyd, pollardRhoFloydImproved, pollardRhoBrent, pollardRhoBrentImproved }) {
+			mpz_class d = kernel(absN, 2, 1, IterationMap()).value;
+			if (d < 1 || absN % d != 0)
+				return "kernel returned " + d.get_str();
+		}
+	}
+
+	// The smooth part up to the largest factor is all of |n|, whatever the budget
+	SmoothOptions smooth;
+	smooth.bound = sorted.empty() ? mpz_class(2) : sorted.back();
+	bool complete = Factorize::findSmoothFactors(n, compare, smooth);
+	product = compare.cofactor;
+	for (const mpz_class& factor : compare) {
+		if (factor > smooth.bound || mpz_probab_prime_p(factor.get_mpz_t(), 25) == 0)
+			return "smooth factor " + factor.get_str();
+		product *= factor;
+	}
+	if (product != n)
+		return "smooth product " + product.get_str();
+	if (complete && abs(compare.cofactor) != 1 && n != 0)
+		return "smooth cofactor " + compare.cofactor.get_str();
+
+	return "";
+}
+
+static std::uint64_t testFactorizationProperties(std::uint64_t cases, unsigned int threads, std::uint64_t seed) {
+	threads = std::max(threads, 1u);
+	Arena::install();
+
+	std::atomic<std::uint64_t> failures(0);
+	std::mutex output;
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> workers;
+	for (unsigned int t = 0; t < threads; t++) {
+		workers.emplace_back([&, t]() {
+			FactorResult result, compare; // Reused, like a batch caller would
+			Factorization factorization;
+			for (std::uint64_t i = t; i < cases; i += threads) {
+				std::mt19937_64 generator(seed ^ (i * 0x9e3779b97f4a7c15));
+				mpz_class n = propertyCase(i, generator);
+				std::string failure = checkProperties(n, seed, result, compare, factorization);
+				if (!failure.empty()) {
+					std::lock_guard<std::mutex> lock(output);
+					if (failures++ < 20)
+						std::cout << "	Case " << i << ", n = " << n.get_str() << ": " << failure << std::endl;
+				}
+			}
+		});
+	}
+	for (std::thread& worker : workers) {
+		worker.join();
+	}
+
+	Arena::uninstall();
+	std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+	auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(end - begin);
+	std::cout << "Cases: " << cases << ", threads: " << threads << ", failures: " << failures << ", elapsed: " << elapsed.count() << " [milliseconds]" << std::endl;
+
+	return failures;
+}
+
+static bool parseArgument(const char* str, std::uint64_t& value) {
+	mpz_class parsed;
+	if (parsed.set_str(str, 10) != 0 || parsed < 0 || mpz_sizeinbase(parsed.get_mpz_t(), 2) > 64) {
+		std::cout << str << ": not a number" << std::endl;
+		return false;
+	}
+	value = toUInt64(parsed);
+	return true;
+}
+
+int main(int argc, char* argv[]) {
+	std::uint64_t cases = 10000;
+	std::uint64_t threads = std::thread::hardware_concurrency();
+	std::uint64_t seed = 0;
+	if ((argc > 1 && !parseArgument(argv[1], cases)) || (argc > 2 && !parseArgument(argv[2], threads)) || (argc > 3 && !parseArgument(argv[3], seed)))
+		return 1;
+
+	return testFactorizationProperties(cases, static_cast<unsigned int>(std::min<std::uint64_t>(threads, 1024)), seed) == 0 ? 0 : 1;
+}
@@ -0,0 +1,120 @@
+#include "sieve.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+static const size_t wheel = 3 * 5 * 7 * 11 * 13; // Period of the pattern in odd numbers (2 * wheel in all numbers)
+
+// pattern[j] says whether 2 * j + 1 is coprime to 3, 5, 7, 11 and 13
+static const std::vector<char>& wheelPattern() {
+	static const std::vector<char> pattern = [] {
+		std::vector<char> pattern(wheel, 1);
+		for (size_t p : { 3, 5, 7, 11, 13 }) {
+			for (size_t m = p; m < 2 * wheel; m += 2 * p) {
+				pattern[m / 2] = 0;
+			}
+		}
+		return pattern;
+	}();
+	return pattern;
+}
+
+static std::uint64_t isqrt(std::uint64_t n) {
+	std::uint64_t root = static_cast<std::uint64_t>(std::sqrt(static_cast<double>(n)));
+	for (; root > 0 && (root > n / root); root--);
+	for (; (root + 1) <= n / (root + 1); root++);
+	return root;
+}
+
+PrimeSieve::PrimeSieve(std::uint64_t limit, size_t segmentSize) : limit(limit), sqrtLimit(isqrt(limit)), segment(std::max<size_t>(std::min<std::uint64_t>(segmentSize, limit / 2 + 1), 64)), low(1), position(0), two(limit >= 2) {
+	sieveSegment();
+}
+
+std::uint64_t PrimeSieve::next() {
+	if (two) {
+		two = false;
+		return 2;
+	}
+
+	for (;;) {
+		for (; position < segment.size(); position++) {
+			if (segment[position]) {
+				std::uint64_t p = low + 2 * position++;
+				if (p > limit) {
+					position = segment.size();
+					return 0;
+				}
+				if (p <= sqrtLimit) {
+					basePrimes.push_back(p);
+				}
+				return p;
+			}
+		}
+
+		if (low + 2 * segment.size() > limit) {
+			return 0;
+		}
+		low += 2 * segment.size();
+		position = 0;
+		sieveSegment();
+	}
+}
+
+void PrimeSieve::sieveSegment() {
+	std::uint64_t high = low + 2 * segment.size();
+
+	// Start from the wheel pattern instead of sieving out the smallest primes
+	const std::vector<char>& pattern = wheelPattern();
+	for (size_t i = 0, j = (low % (2 * wheel)) / 2; i < segment.size(); j = 0) {
+		size_t count = std::min(segment.size() - i, wheel - j);
+		std::memcpy(&segment[i], &pattern[j], count);
+		i += count;
+	}
+
+	if (low == 1) {
+		segment[0] = 0;
+		for (size_t p : { 3, 5, 7, 11, 13 }) {
+			segment[p / 2] = 1;
+		}
+
+		// The first segment contains its own sieving primes, which haven't been returned yet
+		for (std::uint64_t i = 0, p = 1; p * p < high; i++, p += 2) {
+			if (p > 13 && segment[i]) {
+				for (std::uint64_t m = p * p; m < high; m += 2 * p) {
+					segment[(m - low) / 2] = 0;
+				}
+			}
+		}
+		return;
+	}
+
+	// Every prime up to sqrt(high) is smaller than low, so it has already been returned and stored
+	for (const std::uint64_t& p : basePrimes) {
+		if (p * p >= high) {
+			break;
+		}
+		if (p <= 13) {
+			continue;
+		}
+
+		std::uint64_t m = std::max(p * p, (low + p - 1) / p * p);
+		if (m % 2 == 0) {
+			m += p;
+		}
+		for (; m < high; m += 2 * p) {
+			segment[(m - low) / 2] = 0;
+		}
+	}
+}
+
+std::vector<std::uint64_t> primePowers(std::uint64_t bound) {
+	std::vector<std::uint64_t> powers;
+	PrimeSieve primes(bound);
+	for (std::uint64_t p = primes.next(); p; p = primes.next()) {
+		std::uint64_t q = p;
+		for (; q <= bound / p; q *= p);
+		powers.push_back(q);
+	}
+	return powers;
+}
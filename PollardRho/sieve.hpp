@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+// Segmented sieve of Eratosthenes, producing primes in increasing order on demand. Only odd numbers are stored, and multiples of 3, 5, 7, 11 and 13 are copied in from a precomputed wheel pattern rather than sieved
+class PrimeSieve {
+public:
+	// The segment is never larger than the odd numbers up to limit, so a sieve for a handful of small primes stays cheap to construct
+	explicit PrimeSieve(std::uint64_t limit = std::numeric_limits<std::uint32_t>::max(), size_t segmentSize = 32768);
+
+	// Returns the next prime, or 0 once the primes up to limit are exhausted
+	std::uint64_t next();
+
+private:
+	void sieveSegment();
+
+	std::uint64_t limit;
+	std::uint64_t sqrtLimit;
+	std::vector<char> segment; // segment[i] says whether low + 2 * i is prime
+	std::uint64_t low;
+	size_t position;
+	bool two;
+	std::vector<std::uint64_t> basePrimes; // All primes up to sqrt(limit) returned so far, used to sieve the following segments
+};
+
+// For every prime p <= bound, the largest power of p not exceeding bound (the exponents needed for a powersmooth bound in Pollard (p-1))
+std::vector<std::uint64_t> primePowers(std::uint64_t bound);
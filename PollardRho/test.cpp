@@ -1,14 +1,19 @@
 #include "test.hpp"
 
-struct Compare {
-	int val;
-	Compare(const int& n) : val(n) {}
-};
-bool operator==(const std::pair<int, int>& p, const Compare& c) {
-	return c.val == p.second;
+#if defined(_MSC_VER)
+#include <intrin.h> // _umul128, _udiv128
+#endif
+
+void RunningStatistics::add(double value) {
+	// Welford's algorithm, numerically stable without keeping the values around
+	count++;
+	double delta = value - mean;
+	mean += delta / count;
+	m2 += delta * (value - mean);
 }
-bool operator==(const Compare& c, const std::pair<int, int>& p) {
-	return c.val == p.second;
+
+double RunningStatistics::variance() const {
+	return count ? m2 / count : 0.0;
 }
 
 void findSameMod(int p, int q) {
@@ -18,15 +23,15 @@ void findSameMod(int p, int q) {
 		return;
 	}
 
-	std::map<int, std::map<int, int>> mods;
+	// i is never negative, so its residues lie in [0, |p|) and [0, |q|)
+	std::vector<int> mods(size_t(std::abs(p)) * std::abs(q), -1);
 	for (int i = 0; i < n; i += boost::math::sign(n)) {
-		int pMod = i % p;
-		int qMod = i % q;
-		if (mods.find(pMod) != mods.end() && mods[pMod].find(qMod) != mods[pMod].end()) {
-			std::cout << mods[pMod][qMod] << ", " << i << std::endl;
+		int& mod = mods[size_t(i % p) * std::abs(q) + i % q];
+		if (mod != -1) {
+			std::cout << mod << ", " << i << std::endl;
 		}
 		else {
-			mods[pMod][qMod] = i;
+			mod = i;
 		}
 	}
 
@@ -34,7 +39,7 @@ void findSameMod(int p, int q) {
 }
 
 void testPollardFactor(int n) {
-	std::map<int, std::pair<int, double>> factors;
+	std::vector<std::pair<int, double>> factors(n + 1, std::make_pair(0, 0.0)); // indexed by factor: occurences, mean gcd evaluations
 
 	int x0 = 2; // We have shown that changing the inital value has negligible impact on iterations
 	for (int c = 1; c < n; c++) {
@@ -46,13 +51,15 @@ void testPollardFactor(int n) {
 		Result factor = pollardRhoFloyd(n, x0, c);
 		if (factor.value.fits_sint_p()) { // Should alwys be true, since n is an int and its factors must be smaller, but just to be sure
 			factors[factor.value.get_si()].first++;
-			factors[factor.value.get_si()].second += (factor.gcdEvaluations.get_si() - factors[factor.value.get_si()].second) / factors[factor.value.get_si()].first;
+			factors[factor.value.get_si()].second += (factor.gcdEvaluations - factors[factor.value.get_si()].second) / factors[factor.value.get_si()].first;
 		}
 	}
 
 	std::cout << "Occurences of factors found by Pollard Rho:" << std::endl;
-	for (const std::pair<int, std::pair<int, double>>& factor : factors) {
-		std::cout << "\t" << factor.first << ", relative frequency: " << double(factor.second.first) / (n - 1) << ", mean gcd evaluations: " << factor.second.second << std::endl;
+	for (size_t factor = 0; factor < factors.size(); factor++) {
+		if (factors[factor].first) {
+			std::cout << "\t" << factor << ", relative frequency: " << double(factors[factor].first) / (n - 1) << ", mean gcd evaluations: " << factors[factor].second << std::endl;
+		}
 	}
 }
 
@@ -73,15 +80,15 @@ void testPollardRhoRuntime(int maxC, int maxN) {
 				break;
 			}
 
-			std::vector<unsigned long> gcdEvaluations;
-			std::vector<unsigned long> iterations;
+			RunningStatistics gcdEvaluations;
+			RunningStatistics iterations;
 			for (int c = 1; c < maxC; c++) {
 				Result res = pollardRhoFloyd(n, 2, 1);
-				gcdEvaluations.push_back(res.gcdEvaluations.get_ui());
-				iterations.push_back(res.iterations.get_ui());
+				gcdEvaluations.add(double(res.gcdEvaluations));
+				iterations.add(double(res.iterations));
 			}
-			averageGCDEvaluations.push_back(std::make_pair(n.get_ui(), std::accumulate(gcdEvaluations.begin(), gcdEvaluations.end(), 0.0) / gcdEvaluations.size()));
-			averageIterations.push_back(std::make_pair(n.get_ui(), std::accumulate(iterations.begin(), iterations.end(), 0.0) / iterations.size()));
+			averageGCDEvaluations.push_back(std::make_pair(n.get_ui(), gcdEvaluations.mean));
+			averageIterations.push_back(std::make_pair(n.get_ui(), iterations.mean));
 			fourthRoot.push_back(std::make_pair(n.get_ui(), sqrt(sqrt(n.get_ui()))));
 		}
 	}
@@ -126,17 +133,17 @@ void comparePollardRho(unsigned long maxN) {
 			}
 
 			Result resFloyd = pollardRhoFloyd(n, 2, 1);
-			gcdEvaluationsFloyd.push_back(std::make_pair(n.get_ui(), resFloyd.gcdEvaluations.get_ui()));
-			iterationsFloyd.push_back(std::make_pair(n.get_ui(), resFloyd.iterations.get_ui()));
+			gcdEvaluationsFloyd.push_back(std::make_pair(n.get_ui(), resFloyd.gcdEvaluations));
+			iterationsFloyd.push_back(std::make_pair(n.get_ui(), resFloyd.iterations));
 			Result resFloydImproved = pollardRhoFloydImproved(n, 2, 1);
-			gcdEvaluationsFloydImproved.push_back(std::make_pair(n.get_ui(), resFloydImproved.gcdEvaluations.get_ui()));
-			iterationsFloydImproved.push_back(std::make_pair(n.get_ui(), resFloydImproved.iterations.get_ui()));
+			gcdEvaluationsFloydImproved.push_back(std::make_pair(n.get_ui(), resFloydImproved.gcdEvaluations));
+			iterationsFloydImproved.push_back(std::make_pair(n.get_ui(), resFloydImproved.iterations));
 			Result resBrent = pollardRhoBrent(n, 2, 1);
-			gcdEvaluationsBrent.push_back(std::make_pair(n.get_ui(), resBrent.gcdEvaluations.get_ui()));
-			iterationsBrent.push_back(std::make_pair(n.get_ui(), resBrent.iterations.get_ui()));
+			gcdEvaluationsBrent.push_back(std::make_pair(n.get_ui(), resBrent.gcdEvaluations));
+			iterationsBrent.push_back(std::make_pair(n.get_ui(), resBrent.iterations));
 			Result resBrentImproved = pollardRhoBrent(n, 2, 1);
-			gcdEvaluationsBrentImproved.push_back(std::make_pair(n.get_ui(), resBrentImproved.gcdEvaluations.get_ui()));
-			iterationsBrentImproved.push_back(std::make_pair(n.get_ui(), resBrentImproved.iterations.get_ui()));
+			gcdEvaluationsBrentImproved.push_back(std::make_pair(n.get_ui(), resBrentImproved.gcdEvaluations));
+			iterationsBrentImproved.push_back(std::make_pair(n.get_ui(), resBrentImproved.iterations));
 		}
 	}
 
@@ -175,34 +182,83 @@ void comparePollardRho(unsigned long maxN) {
 	file.close();
 }
 
+void testRetryStrategies(unsigned long maxN, unsigned int starts, std::uint64_t seed) {
+	// Twin prime semiprimes make c fail in streaks, which is what the random retries are meant to break up. Every semiprime is started from c = 1, ..., starts
+	for (Retry retry : { Retry::Linear, Retry::Random }) {
+		std::ifstream file("../b001097 (twin primes).txt");
+		std::string line1, line2;
+
+		size_t semiprimes = 0;
+		size_t retried = 0;
+		std::uint64_t retries = 0;
+		std::uint64_t maxRetries = 0;
+		std::uint64_t iterations = 0;
+		while (std::getline(file, line1)) {
+			if (std::getline(file, line2)) {
+				mpz_class p1(line1.substr(line1.find(' ') + 1));
+				mpz_class p2(line2.substr(line2.find(' ') + 1));
+				mpz_class n = p1 * p2;
+				if (n > maxN) {
+					break;
+				}
+
+				semiprimes++;
+				for (unsigned int start = 1; start <= starts; start++) {
+					mpz_class x0 = 2;
+					mpz_class c = start;
+					std::optional<RetryStream> stream;
+					std::uint64_t runs = 0;
+					Result res;
+					for (res = pollardRhoFloydImproved(n, x0, c); res.value == n; res = pollardRhoFloydImproved(n, x0, c), runs++) {
+						iterations += res.iterations;
+						Factorize::_retry(n, x0, c, IterationMap(), retry, seed, stream);
+					}
+					iterations += res.iterations;
+
+					retried += runs > 0;
+					retries += runs;
+					maxRetries = std::max(maxRetries, runs);
+				}
+			}
+		}
+
+		std::cout << (retry == Retry::Linear ? "Linear" : "Random") << ": semiprimes: " << semiprimes << ", failed starts: " << retried << ", total retries: " << retries << ", max retries: " << maxRetries << ", total iterations: " << iterations << std::endl;
+
+		file.close();
+	}
+}
+
 std::pair<size_t, std::pair<std::pair<int, int>, std::pair<int, int>>> testPollardRhoConsecutiveFailuresX(int maxP, int maxX0) {
-	std::vector<std::vector<int>> iterationsMatrix;
+	std::vector<int> iterationsMatrix; // one row of maxX0 + 1 entries per p
+	size_t row = maxX0 + 1;
 
-	mpz_class c = 1;
+	int c = 1;
 
 	size_t pOffset = 9;
-	for (mpz_class p = 23; p <= maxP; mpz_nextprime(p.get_mpz_t(), p.get_mpz_t())) {
-		std::vector<int> iterations;
+	PrimeSieve primes(maxP);
+	for (std::uint64_t p = primes.next(); p; p = primes.next()) {
+		if (p < 23) {
+			continue;
+		}
 
 		for (int x0 = 0; x0 <= maxX0; x0++) {
-			iterations.push_back(findCollision(p, x0, c));
+			iterationsMatrix.push_back(findCollision<std::uint32_t>(std::uint32_t(p), x0, c).iterations);
 		}
-
-		iterationsMatrix.push_back(iterations);
 	}
+	size_t rows = iterationsMatrix.size() / row;
 
 	size_t streak = 0;
 	std::pair<int, int> minmaxX0;
 	std::pair<int, int> ps;
-	for (size_t p1 = 0; p1 < iterationsMatrix.size() - 1; p1++) {
-		std::vector<int> iterationsVec = iterationsMatrix[p1];
+	for (size_t p1 = 0; p1 < rows - 1; p1++) {
+		const int* iterationsVec = &iterationsMatrix[p1 * row];
 
-		for (size_t p2 = p1 + 1; p2 < iterationsMatrix.size(); p2++) {
-			std::vector<int> iterationsVecCompare = iterationsMatrix[p2];
+		for (size_t p2 = p1 + 1; p2 < rows; p2++) {
+			const int* iterationsVecCompare = &iterationsMatrix[p2 * row];
 
 			size_t currentStreak = 0;
 			int minX0;
-			for (size_t i = 0; i < iterationsVec.size(); i++) {
+			for (size_t i = 0; i < row; i++) {
 				if (iterationsVec[i] == iterationsVecCompare[i]) {
 					if (currentStreak == 0) {
 						minX0 = i;
@@ -225,33 +281,36 @@ std::pair<size_t, std::pair<std::pair<int, int>, std::pair<int, int>>> testPolla
 }
 
 std::pair<size_t, std::pair<std::pair<int, int>, std::pair<int, int>>> testPollardRhoConsecutiveFailuresC(int maxP, int maxC) {
-	std::vector<std::vector<int>> iterationsMatrix;
+	std::vector<int> iterationsMatrix; // one row of maxC entries per p
+	size_t row = maxC;
 
-	mpz_class x0 = 2;
+	int x0 = 2;
 
 	size_t pOffset = 9;
-	for (mpz_class p = 23; p <= maxP; mpz_nextprime(p.get_mpz_t(), p.get_mpz_t())) {
-		std::vector<int> iterations;
+	PrimeSieve primes(maxP);
+	for (std::uint64_t p = primes.next(); p; p = primes.next()) {
+		if (p < 23) {
+			continue;
+		}
 
 		for (int c = 1; c <= maxC; c++) {
-			iterations.push_back(findCollision(p, x0, c));
+			iterationsMatrix.push_back(findCollision<std::uint32_t>(std::uint32_t(p), x0, c).iterations);
 		}
-
-		iterationsMatrix.push_back(iterations);
 	}
+	size_t rows = iterationsMatrix.size() / row;
 
 	size_t streak = 0;
 	std::pair<int, int> minmaxC;
 	std::pair<int, int> ps;
-	for (size_t p1 = 0; p1 < iterationsMatrix.size() - 1; p1++) {
-		std::vector<int> iterationsVec = iterationsMatrix[p1];
+	for (size_t p1 = 0; p1 < rows - 1; p1++) {
+		const int* iterationsVec = &iterationsMatrix[p1 * row];
 
-		for (size_t p2 = p1 + 1; p2 < iterationsMatrix.size(); p2++) {
-			std::vector<int> iterationsVecCompare = iterationsMatrix[p2];
+		for (size_t p2 = p1 + 1; p2 < rows; p2++) {
+			const int* iterationsVecCompare = &iterationsMatrix[p2 * row];
 
 			size_t currentStreak = 0;
 			int minC;
-			for (size_t i = 0; i < iterationsVec.size(); i++) {
+			for (size_t i = 0; i < row; i++) {
 				if (iterationsVec[i] == iterationsVecCompare[i]) {
 					if (currentStreak == 0) {
 						minC = i;
@@ -273,62 +332,118 @@ std::pair<size_t, std::pair<std::pair<int, int>, std::pair<int, int>>> testPolla
 	return std::make_pair(streak, std::make_pair(minmaxC, ps));
 }
 
-int findCollision(mpz_class n, mpz_class x0, mpz_class c) {
-	c += n * (c < 0); // make c positive mod N to avoid having to check if x1 or x2 are negative after modulo
+static std::uint32_t f(std::uint32_t x, std::uint32_t c, std::uint32_t n) {
+	return std::uint32_t((std::uint64_t(x) * x + c) % n);
+}
+
+static std::uint64_t f(std::uint64_t x, std::uint64_t c, std::uint64_t n) {
+#if defined(_MSC_VER)
+	std::uint64_t high;
+	std::uint64_t low = _umul128(x, x, &high);
+	std::uint64_t remainder;
+	_udiv128(high, low, n, &remainder);
+	return (remainder + c) % n;
+#else
+	return std::uint64_t((static_cast<unsigned __int128>(x) * x + c) % n);
+#endif
+}
+
+template <typename T>
+static T reduce(std::int64_t value, T n) {
+	std::int64_t remainder = value % static_cast<std::int64_t>(n);
+	return T(remainder < 0 ? remainder + static_cast<std::int64_t>(n) : remainder);
+}
 
-	mpz_class x1 = f(x0, c) % n;
-	mpz_class x2 = f(x1, c) % n;
-	int iterations = 1;
-	for (; x1 != x2; iterations++) {
-		x1 = f(x1, c) % n;
-		x2 = f(f(x2, c), c) % n;
+template <typename T>
+Collision findCollision(T n, std::int64_t x0, std::int64_t c, bool exact, std::uint64_t maxIterations) {
+	Collision collision = { false, 0, 0, 0 };
+	T x = reduce(x0, n);
+	T cMod = reduce(c, n); // make c positive mod N, so no intermediate value is ever negative
+
+	// Brent: compare against the value saved at every power of two, which also yields lambda directly
+	T tortoise = x;
+	T hare = f(x, cMod, n);
+	std::uint64_t power = 1;
+	std::uint64_t lambda = 1;
+	for (collision.iterations = 1; tortoise != hare; collision.iterations++, lambda++) {
+		if (collision.iterations >= maxIterations) {
+			return collision;
+		}
+		if (power == lambda) {
+			tortoise = hare;
+			power *= 2;
+			lambda = 0;
+		}
+		hare = f(hare, cMod, n);
 	}
+	collision.found = true;
+	collision.lambda = lambda;
+
+	if (exact) {
+		// Walk two iterators lambda apart from x0 until they meet at the start of the cycle
+		tortoise = hare = x;
+		for (std::uint64_t i = 0; i < lambda; i++) {
+			hare = f(hare, cMod, n);
+		}
+		for (; tortoise != hare; collision.mu++) {
+			tortoise = f(tortoise, cMod, n);
+			hare = f(hare, cMod, n);
+		}
 
-	return iterations;
+		collision.iterations = collision.mu > lambda ? (collision.mu + lambda - 1) / lambda * lambda : lambda;
+	}
+
+	return collision;
 }
 
+template Collision findCollision<std::uint32_t>(std::uint32_t n, std::int64_t x0, std::int64_t c, bool exact, std::uint64_t maxIterations);
+template Collision findCollision<std::uint64_t>(std::uint64_t n, std::int64_t x0, std::int64_t c, bool exact, std::uint64_t maxIterations);
+
 void testAverageP(int minX0, int maxX0, int minP, int maxP) {
-	std::map<int, std::map<int, double>> averageIterations; // x0, p, average across c
+	size_t ps = maxP - minP + 1;
+	std::vector<double> averageIterations(size_t(maxX0 - minX0 + 1) * ps); // one row per x0, one column per p: average across c
 	std::vector<std::pair<int, double>> sqrtFunc;
+	std::vector<int> iterations; // indexed by c - 1, reused for every p
 	std::ofstream file("../notableIterations.txt");
 
 	for (int x0 = minX0; x0 <= maxX0; x0++) {
 		for (int p = minP; p <= maxP; p++) {
-			sqrtFunc.push_back(std::make_pair(p, sqrt(p)));
-			std::map<int, int> iterations;
+			if (x0 == minX0) {
+				sqrtFunc.push_back(std::make_pair(p, sqrt(p)));
+			}
+			iterations.resize(p > 1 ? p - 1 : 0);
+			RunningStatistics statistics;
 			for (int c = 1; c < p; c++) {
-				int it = findCollision(p, x0, c);
-				iterations[c] = it;
+				int it = findCollision<std::uint32_t>(p, x0, c).iterations;
+				iterations[c - 1] = it;
+				statistics.add(it);
 			}
 
-			double mean = std::accumulate(iterations.begin(), iterations.end(), 0.0, [](double value, const std::pair<int, int>& p) { return value + p.second; }) / iterations.size();
-			averageIterations[x0][p] = mean;
+			double mean = statistics.mean;
+			averageIterations[(x0 - minX0) * ps + (p - minP)] = mean;
 			if (mean > 3 * sqrt(p)) {
 				file << "Unusually high iterations for p = " << p << ", x0 = " << x0 << ": " << mean << std::endl;
-				auto minmax = std::minmax_element(iterations.begin(), iterations.end(), [](const std::pair<int, double>& p1, const std::pair<int, double>& p2) { return p1.second < p2.second; });
-				file << "\t Maximum value: " << minmax.second->second << " at c = " << minmax.second->first << ", occured " << std::count(iterations.begin(), iterations.end(), Compare(minmax.second->second)) << " times" << std::endl;
-				file << "\t Minimum value: " << minmax.first->second << " at c = " << minmax.first->first << ", occured " << std::count(iterations.begin(), iterations.end(), Compare(minmax.first->second)) << " times" << std::endl;
-				std::vector<double> diff(iterations.size());
-				std::transform(iterations.begin(), iterations.end(), diff.begin(), [mean](const std::pair<int, int>& p) { return p.second - mean; });
-				file << "\t Standard deviation: " << sqrt(std::inner_product(diff.begin(), diff.end(), diff.begin(), 0.0) / diff.size()) << std::endl;
+				auto minmax = std::minmax_element(iterations.begin(), iterations.end());
+				file << "\t Maximum value: " << *minmax.second << " at c = " << minmax.second - iterations.begin() + 1 << ", occured " << std::count(iterations.begin(), iterations.end(), *minmax.second) << " times" << std::endl;
+				file << "\t Minimum value: " << *minmax.first << " at c = " << minmax.first - iterations.begin() + 1 << ", occured " << std::count(iterations.begin(), iterations.end(), *minmax.first) << " times" << std::endl;
+				file << "\t Standard deviation: " << sqrt(statistics.variance()) << std::endl;
 			}
 		}
 	}
 
 	Gnuplot gp("gnuplot -persist");
-	std::vector<double> minIterations;
-	std::vector<double> maxIterations;
-	for (const auto& averageIteration : averageIterations) {
-		minIterations.push_back(std::min_element(averageIteration.second.begin(), averageIteration.second.end(), [](const std::pair<int, double>& p1, const std::pair<int, double>& p2) { return p1.second < p2.second; })->second);
-		maxIterations.push_back(std::max_element(averageIteration.second.begin(), averageIteration.second.end(), [](const std::pair<int, double>& p1, const std::pair<int, double>& p2) { return p1.second < p2.second; })->second);
-	}
+	auto minmax = std::minmax_element(averageIterations.begin(), averageIterations.end());
 
 	gp << "set xrange [" << minP << ':' << maxP << "]\n";
-	gp << "set yrange [" << *std::min_element(minIterations.begin(), minIterations.end()) << ':' << *std::max_element(maxIterations.begin(), maxIterations.end()) << "]\n";
+	gp << "set yrange [" << *minmax.first << ':' << *minmax.second << "]\n";
 	gp << "plot";
-	for (const auto& averageIteration : averageIterations) {
-		std::string title = "with lines title 'avg. iterations across c from 1 to p, p from " + std::to_string(minP) + " to " + std::to_string(maxP) + ", x0 = " + std::to_string(averageIteration.first) + "',";
-		gp << gp.file1d(averageIteration.second) << title;
+	std::vector<std::pair<int, double>> series(ps);
+	for (int x0 = minX0; x0 <= maxX0; x0++) {
+		for (size_t i = 0; i < ps; i++) {
+			series[i] = std::make_pair(minP + int(i), averageIterations[(x0 - minX0) * ps + i]);
+		}
+		std::string title = "with lines title 'avg. iterations across c from 1 to p, p from " + std::to_string(minP) + " to " + std::to_string(maxP) + ", x0 = " + std::to_string(x0) + "',";
+		gp << gp.file1d(series) << title;
 	}
 	gp << gp.file1d(sqrtFunc) << "with lines title 'sqrt'";
 	gp << std::endl;
@@ -337,33 +452,33 @@ void testAverageP(int minX0, int maxX0, int minP, int maxP) {
 }
 
 void testAverageC(int minX0, int maxX0, int minP, int maxP) {
-	std::map<int, std::map<int, double>> averageIterations; // x0, c, average across p
+	size_t cs = minP; // c from -3 to minP - 4
+	std::vector<double> averageIterations(size_t(maxX0 - minX0 + 1) * cs); // one row per x0, one column per c: average across p
 
 	for (int x0 = minX0; x0 <= maxX0; x0++) {
 		for (int c = -3; c < minP - 3; c++) {
-			std::vector<int> iterations;
+			RunningStatistics statistics;
 			for (int p = minP; p <= maxP; p++) {
-				int it = findCollision(p, x0, c);
-				iterations.push_back(it);
+				int it = findCollision<std::uint32_t>(p, x0, c).iterations;
+				statistics.add(it);
 			}
-			averageIterations[x0][c] = std::accumulate(iterations.begin(), iterations.end(), 0.0) / iterations.size();
+			averageIterations[(x0 - minX0) * cs + (c + 3)] = statistics.mean;
 		}
 	}
 
 	Gnuplot gp("gnuplot -persist");
-	std::vector<double> minIterations;
-	std::vector<double> maxIterations;
-	for (const auto& averageIteration : averageIterations) {
-		minIterations.push_back(std::min_element(averageIteration.second.begin(), averageIteration.second.end(), [](const std::pair<int, double>& p1, const std::pair<int, double>& p2) { return p1.second < p2.second; })->second);
-		maxIterations.push_back(std::max_element(averageIteration.second.begin(), averageIteration.second.end(), [](const std::pair<int, double>& p1, const std::pair<int, double>& p2) { return p1.second < p2.second; })->second);
-	}
+	auto minmax = std::minmax_element(averageIterations.begin(), averageIterations.end());
 
 	gp << "set xrange [-3:" << minP - 3 << "]\n";
-	gp << "set yrange [" << *std::min_element(minIterations.begin(), minIterations.end()) << ':' << *std::max_element(maxIterations.begin(), maxIterations.end()) << "]\n";
+	gp << "set yrange [" << *minmax.first << ':' << *minmax.second << "]\n";
 	gp << "plot";
-	for (const auto& averageIteration : averageIterations) {
-		std::string title = "with lines title 'avg. iterations across p from " + std::to_string(minP) + " to " + std::to_string(maxP) + ", c from -3 to " + std::to_string(minP - 3) + ", x0 = " + std::to_string(averageIteration.first) + "',";
-		gp << gp.file1d(averageIteration.second) << title;
+	std::vector<std::pair<int, double>> series(cs);
+	for (int x0 = minX0; x0 <= maxX0; x0++) {
+		for (size_t i = 0; i < cs; i++) {
+			series[i] = std::make_pair(int(i) - 3, averageIterations[(x0 - minX0) * cs + i]);
+		}
+		std::string title = "with lines title 'avg. iterations across p from " + std::to_string(minP) + " to " + std::to_string(maxP) + ", c from -3 to " + std::to_string(minP - 3) + ", x0 = " + std::to_string(x0) + "',";
+		gp << gp.file1d(series) << title;
 	}
 	gp << std::endl;
 }
@@ -375,12 +490,13 @@ void visualizeIterationsP(int x0, int c) {
 		return;
 	}
 
-	std::map<int, int> iterations;
+	std::vector<std::pair<int, int>> iterations;
 	std::vector<std::pair<int, double>> sqrtFunc;
 	int maxP = 10000;
+	iterations.reserve(maxP);
 	for (int p = 1; p <= maxP; p++) {
-		int it = findCollision(p, x0, c);
-		iterations[p] = it;
+		int it = findCollision<std::uint32_t>(p, x0, c).iterations;
+		iterations.push_back(std::make_pair(p, it));
 		sqrtFunc.push_back(std::make_pair(p, sqrt(p)));
 	}
 
@@ -394,10 +510,11 @@ void visualizeIterationsP(int x0, int c) {
 }
 
 void visualizeIterationsC(int x0, int p) {
-	std::map<int, int> iterations;
+	std::vector<std::pair<int, int>> iterations;
+	iterations.reserve(p);
 	for (int c = 1; c < p; c++) {
-		int it = findCollision(p, x0, c);
-		iterations[c] = it;
+		int it = findCollision<std::uint32_t>(p, x0, c).iterations;
+		iterations.push_back(std::make_pair(c, it));
 	}
 
 	Gnuplot gp("gnuplot -persist");
@@ -408,10 +525,11 @@ void visualizeIterationsC(int x0, int p) {
 }
 
 void visualizeIterationsX(int c, int p) {
-	std::map<int, int> iterations;
+	std::vector<std::pair<int, int>> iterations;
+	iterations.reserve(p);
 	for (int x0 = 0; x0 < p; x0++) {
-		int it = findCollision(p, x0, c);
-		iterations[x0] = it;
+		int it = findCollision<std::uint32_t>(p, x0, c).iterations;
+		iterations.push_back(std::make_pair(x0, it));
 	}
 
 	Gnuplot gp("gnuplot -persist");
@@ -1,9 +1,23 @@
 #pragma once
 
 #include "factorize.hpp"
+#include "sieve.hpp"
 
+#include <fstream>
+
+#include <gnuplot-iostream.h>
 #include <boost/math/special_functions/sign.hpp>
 
+// Streaming mean and (population) variance, so sweeps don't need to keep every sample
+struct RunningStatistics {
+	size_t count = 0;
+	double mean = 0.0;
+	double m2 = 0.0;
+
+	void add(double value);
+	double variance() const;
+};
+
 void findSameMod(int p, int q);
 
 void testPollardFactor(int n);
@@ -12,11 +26,22 @@ void testPollardRhoRuntime(int maxC, int maxN);
 
 void comparePollardRho(unsigned long maxN);
 
+void testRetryStrategies(unsigned long maxN, unsigned int starts = 20, std::uint64_t seed = 0);
+
 std::pair<size_t, std::pair<std::pair<int, int>, std::pair<int, int>>> testPollardRhoConsecutiveFailuresX(int maxP, int maxX0);
 
 std::pair<size_t, std::pair<std::pair<int, int>, std::pair<int, int>>> testPollardRhoConsecutiveFailuresC(int maxP, int maxC);
 
-int findCollision(mpz_class n, mpz_class x0, mpz_class c);
+struct Collision {
+	bool found; // False if maxIterations was reached first
+	std::uint64_t mu; // Tail length, only computed if exact
+	std::uint64_t lambda; // Cycle length
+	std::uint64_t iterations; // If exact, the index at which Floyd's algorithm collides (smallest positive multiple of lambda >= mu), otherwise the number of steps Brent's algorithm took
+};
+
+// Finds the cycle of x -> x * x + c mod n starting at x0, using Brent's cycle detection on native integers (instantiated for std::uint32_t and std::uint64_t)
+template <typename T>
+Collision findCollision(T n, std::int64_t x0, std::int64_t c, bool exact = true, std::uint64_t maxIterations = std::numeric_limits<std::uint64_t>::max());
 
 void testAverageP(int minX0, int maxX0, int minP, int maxP);
 
@@ -0,0 +1,145 @@
+#include "trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+	struct Event {
+		const char* name;
+		std::uint64_t start;
+		std::uint64_t end;
+		std::uint32_t depth;
+	};
+
+	struct ThreadBuffer {
+		unsigned int tid;
+		std::mutex mutex; // Only contended while clear() or write() runs, the owning thread is the only other user
+		std::vector<Event> events;
+	};
+
+	std::atomic<bool> isEnabled(false);
+	std::atomic<std::uint64_t> origin(0);
+
+	// Buffers stay registered after their thread exits, so its spans still end up in the trace
+	std::mutex buffersMutex;
+	std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
+	thread_local std::shared_ptr<ThreadBuffer> buffer;
+	thread_local std::uint32_t depth = 0;
+
+	ThreadBuffer& threadBuffer() {
+		if (!buffer) {
+			std::lock_guard<std::mutex> lock(buffersMutex);
+			buffer = std::make_shared<ThreadBuffer>();
+			buffer->tid = static_cast<unsigned int>(buffers.size());
+			buffers.push_back(buffer);
+		}
+		return *buffer;
+	}
+}
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+namespace {
+	// Read during static initialization, so by the first call of Trace::ticksPerMicrosecond() enough time has usually passed to calibrate without waiting
+	const std::chrono::steady_clock::time_point calibrationBegin = std::chrono::steady_clock::now();
+	const std::uint64_t calibrationTicks = Trace::now();
+}
+#endif
+
+double Trace::ticksPerMicrosecond() {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+	static const double ticks = []() {
+		std::chrono::steady_clock::time_point begin = calibrationBegin;
+		std::uint64_t startTicks = calibrationTicks;
+		if (startTicks == 0) { // Called from another static initializer, before the reference point was taken
+			begin = std::chrono::steady_clock::now();
+			startTicks = now();
+		}
+		std::chrono::steady_clock::time_point end;
+		do {
+			end = std::chrono::steady_clock::now();
+		} while (end - begin < std::chrono::milliseconds(1));
+		std::uint64_t endTicks = now();
+		return double(endTicks - startTicks) / std::chrono::duration_cast<std::chrono::duration<double, std::micro>>(end - begin).count();
+	}();
+	return ticks;
+#else
+	return 1000.0;
+#endif
+}
+
+void Trace::enable(bool on) {
+	if (on && !isEnabled) {
+		ticksPerMicrosecond(); // Calibrate now rather than when the first span ends
+		if (origin == 0)
+			origin = now();
+	}
+	isEnabled = on;
+}
+
+bool Trace::enabled() {
+	return isEnabled.load(std::memory_order_relaxed);
+}
+
+void Trace::clear() {
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	for (const std::shared_ptr<ThreadBuffer>& threadBuffer : buffers) {
+		std::lock_guard<std::mutex> bufferLock(threadBuffer->mutex);
+		threadBuffer->events.clear();
+	}
+	origin = isEnabled ? now() : 0;
+}
+
+bool Trace::write(const std::string& path) {
+	std::ofstream file(path, std::ios::trunc);
+	if (!file) {
+		std::cout << "Can't write the trace to " << path << "." << std::endl;
+		return false;
+	}
+
+	double ticks = ticksPerMicrosecond();
+	std::uint64_t zero = origin;
+	bool first = true;
+	file << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+	std::lock_guard<std::mutex> lock(buffersMutex);
+	for (const std::shared_ptr<ThreadBuffer>& threadBuffer : buffers) {
+		std::lock_guard<std::mutex> bufferLock(threadBuffer->mutex);
+		for (const Event& event : threadBuffer->events) {
+			// Span names are identifiers from the code, so they need no escaping
+			file << (first ? "\n" : ",\n");
+			file << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << threadBuffer->tid;
+			// Spans that were already running when clear() moved the origin are cut off at it
+			std::uint64_t start = std::max(event.start, zero);
+			file << ",\"ts\":" << double(start - zero) / ticks << ",\"dur\":" << double(event.end - start) / ticks;
+			file << ",\"args\":{\"depth\":" << event.depth << "}}";
+			first = false;
+		}
+	}
+	file << "\n]}\n";
+
+	return bool(file);
+}
+
+Trace::Span::Span(const char* name) : name(name), start(now()), recording(enabled()) {
+	if (recording)
+		depth++;
+}
+
+Trace::Span::~Span() {
+	if (recording) {
+		depth--;
+		std::uint64_t end = now();
+		ThreadBuffer& own = threadBuffer();
+		std::lock_guard<std::mutex> lock(own.mutex);
+		own.events.push_back({ name, start, end, depth });
+	}
+}
+
+std::chrono::microseconds Trace::Span::elapsed() const {
+	return std::chrono::microseconds(static_cast<std::int64_t>(double(now() - start) / ticksPerMicrosecond()));
+}
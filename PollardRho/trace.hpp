@@ -0,0 +1,56 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#else
+#include <time.h>
+#endif
+
+// Cheap timing of the factorization stages: a Span reads the time stamp counter (clock_gettime where there is none) when it starts and ends.
+// While tracing is enabled, every span is also recorded for its thread, with its nesting depth, and Trace::write() exports them as Chrome trace events (chrome://tracing, ui.perfetto.dev)
+namespace Trace {
+	inline std::uint64_t now() {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+		return __rdtsc();
+#elif defined(_MSC_VER)
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#else
+		timespec time;
+		clock_gettime(CLOCK_MONOTONIC, &time);
+		return std::uint64_t(time.tv_sec) * 1000000000 + time.tv_nsec;
+#endif
+	}
+
+	// Calibrated against steady_clock on first use if now() reads the time stamp counter, over the time since the program started (waiting only if that is less than a millisecond)
+	double ticksPerMicrosecond();
+
+	void enable(bool on = true);
+	bool enabled();
+
+	// Drops every recorded span. Safe while other threads are recording, spans that end afterwards are kept
+	void clear();
+
+	// Writes the recorded spans of all threads as a Chrome trace event file. Spans that are still running on other threads are left out
+	bool write(const std::string& path);
+
+	class Span {
+	public:
+		explicit Span(const char* name); // name has to outlive the trace, like a string literal
+		~Span();
+		Span(const Span&) = delete;
+		Span& operator=(const Span&) = delete;
+
+		std::chrono::microseconds elapsed() const;
+
+	private:
+		const char* name;
+		std::uint64_t start;
+		bool recording;
+	};
+}